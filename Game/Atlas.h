@@ -0,0 +1,246 @@
+#pragma once
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#ifdef __APPLE__
+    #include <SDL2/SDL.h>
+    #include <SDL2/SDL_image.h>
+#else
+    #include <SDL.h>
+    #include <SDL_image.h>
+#endif
+
+using namespace std;
+
+// Спрайты атласа. WHITE - белый квадрат, из которого рисуются
+// цветные рамки подсветки (цвет задается вершинами).
+enum class Sprite
+{
+    BOARD,
+    WHITE_PIECE,
+    BLACK_PIECE,
+    WHITE_QUEEN,
+    BLACK_QUEEN,
+    BACK,
+    REPLAY,
+    WHITE_WINS,
+    BLACK_WINS,
+    DRAW,
+    WHITE,
+    COUNT
+};
+
+// Все картинки игры в одной текстуре.
+// Картинки загружаются с диска один раз при запуске и копируются
+// в одну поверхность (раскладка полками: слева направо, строками),
+// из которой создается текстура. Кадр собирается как список
+// прямоугольников с координатами в атласе и рисуется одним вызовом
+// SDL_RenderGeometry. Если атлас не помещается в предельный размер
+// текстуры, картинки уменьшаются: на экране они все равно меньше исходных.
+class TextureAtlas
+{
+  public:
+    TextureAtlas() = default;
+
+    TextureAtlas(const TextureAtlas &) = delete;
+    TextureAtlas &operator=(const TextureAtlas &) = delete;
+
+    ~TextureAtlas()
+    {
+        release();
+    }
+
+    // Освобождает текстуру (до уничтожения рендерера)
+    void release()
+    {
+        if (texture)
+            SDL_DestroyTexture(texture);
+        texture = nullptr;
+    }
+
+    // Загружает картинки paths (по одной на каждый спрайт до WHITE, в порядке Sprite)
+    // и создает текстуру для ren. Возвращает описание ошибки или пустую строку.
+    string load(SDL_Renderer *ren, const vector<string> &paths)
+    {
+        vector<SDL_Surface *> images;
+        auto free_images = [&]() {
+            for (SDL_Surface *image : images)
+                SDL_FreeSurface(image);
+        };
+        for (const auto &path : paths)
+        {
+            SDL_Surface *loaded = IMG_Load(path.c_str());
+            if (!loaded)
+            {
+                free_images();
+                return "IMG_Load can't load " + path;
+            }
+            // Картинки приводятся к формату атласа, чтобы копироваться с масштабированием
+            SDL_Surface *image = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+            SDL_FreeSurface(loaded);
+            if (!image)
+            {
+                free_images();
+                return "SDL_ConvertSurfaceFormat can't convert " + path;
+            }
+            images.push_back(image);
+        }
+
+        // Предельный размер текстуры: ограничение видеокарты, но не больше MAX_SIZE
+        SDL_RendererInfo info;
+        int max_w = MAX_SIZE, max_h = MAX_SIZE;
+        if (SDL_GetRendererInfo(ren, &info) == 0)
+        {
+            if (info.max_texture_width > 0)
+                max_w = min(max_w, info.max_texture_width);
+            if (info.max_texture_height > 0)
+                max_h = min(max_h, info.max_texture_height);
+        }
+        // Раскладка с уменьшением, пока атлас не поместится
+        int atlas_w = 0, atlas_h = 0;
+        for (double scale = 1;; scale *= 0.9)
+        {
+            if (pack(images, scale, max_w, atlas_w, atlas_h) && atlas_h <= max_h)
+                break;
+        }
+
+        SDL_Surface *atlas = SDL_CreateRGBSurfaceWithFormat(0, atlas_w, atlas_h, 32, SDL_PIXELFORMAT_RGBA32);
+        if (!atlas)
+        {
+            free_images();
+            return "SDL_CreateRGBSurfaceWithFormat can't create atlas surface";
+        }
+        for (size_t i = 0; i < images.size(); ++i)
+        {
+            // Копировать вместе с прозрачностью, а не накладывать
+            SDL_SetSurfaceBlendMode(images[i], SDL_BLENDMODE_NONE);
+            SDL_Rect dst = rects[i];
+            SDL_BlitScaled(images[i], nullptr, atlas, &dst);
+        }
+        SDL_FillRect(atlas, &rects[int(Sprite::WHITE)], 0xFFFFFFFF);
+        free_images();
+
+        release();
+        texture = SDL_CreateTextureFromSurface(ren, atlas);
+        SDL_FreeSurface(atlas);
+        if (!texture)
+            return "SDL_CreateTextureFromSurface can't create atlas texture";
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        width = atlas_w;
+        height = atlas_h;
+        return "";
+    }
+
+    // Начинает новый кадр
+    void clear()
+    {
+        quads.clear();
+    }
+
+    // Добавляет спрайт sprite в прямоугольник dst окна, окрашенный в color
+    void add(const Sprite sprite, const SDL_Rect &dst, const SDL_Color color = {255, 255, 255, 255})
+    {
+        quads.push_back({sprite, dst, color});
+    }
+
+    // Добавляет рамку прямоугольника dst толщиной thickness цвета color
+    void add_frame(const SDL_Rect &dst, const int thickness, const SDL_Color color)
+    {
+        add(Sprite::WHITE, {dst.x, dst.y, dst.w, thickness}, color);
+        add(Sprite::WHITE, {dst.x, dst.y + dst.h - thickness, dst.w, thickness}, color);
+        add(Sprite::WHITE, {dst.x, dst.y, thickness, dst.h}, color);
+        add(Sprite::WHITE, {dst.x + dst.w - thickness, dst.y, thickness, dst.h}, color);
+    }
+
+    // Рисует кадр одним вызовом отрисовки. Возвращает false при ошибке SDL.
+    bool draw(SDL_Renderer *ren)
+    {
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+        vertices.clear();
+        indices.clear();
+        for (const auto &quad : quads)
+        {
+            const SDL_Rect &src = rects[int(quad.sprite)];
+            // У белого квадрата берется середина, чтобы края не смешивались с соседями
+            const float inset = quad.sprite == Sprite::WHITE ? 1.0f : 0.0f;
+            const float u0 = (src.x + inset) / width, u1 = (src.x + src.w - inset) / width;
+            const float v0 = (src.y + inset) / height, v1 = (src.y + src.h - inset) / height;
+            const float x0 = float(quad.dst.x), x1 = float(quad.dst.x + quad.dst.w);
+            const float y0 = float(quad.dst.y), y1 = float(quad.dst.y + quad.dst.h);
+            const int base = int(vertices.size());
+            vertices.push_back({{x0, y0}, quad.color, {u0, v0}});
+            vertices.push_back({{x1, y0}, quad.color, {u1, v0}});
+            vertices.push_back({{x1, y1}, quad.color, {u1, v1}});
+            vertices.push_back({{x0, y1}, quad.color, {u0, v1}});
+            for (const int corner : {0, 1, 2, 0, 2, 3})
+                indices.push_back(base + corner);
+        }
+        return SDL_RenderGeometry(ren, texture, vertices.data(), int(vertices.size()), indices.data(),
+                                  int(indices.size())) == 0;
+#else
+        // SDL до 2.0.18 без SDL_RenderGeometry: по вызову на спрайт, но из одной текстуры
+        bool ok = true;
+        for (const auto &quad : quads)
+        {
+            SDL_SetTextureColorMod(texture, quad.color.r, quad.color.g, quad.color.b);
+            ok = SDL_RenderCopy(ren, texture, &rects[int(quad.sprite)], &quad.dst) == 0 && ok;
+        }
+        SDL_SetTextureColorMod(texture, 255, 255, 255);
+        return ok;
+#endif
+    }
+
+  private:
+    // Наибольшая сторона атласа
+    static const int MAX_SIZE = 4096;
+    // Промежуток между картинками, чтобы при масштабировании не смешивались соседние
+    static const int PADDING = 2;
+    // Сторона белого квадрата
+    static const int WHITE_SIZE = 4;
+
+    struct Quad
+    {
+        Sprite sprite;
+        SDL_Rect dst;
+        SDL_Color color;
+    };
+
+    // Раскладывает картинки images, уменьшенные в scale раз, полками шириной не больше max_w.
+    // Записывает места картинок в rects и размеры атласа. Возвращает false, если не помещается.
+    bool pack(const vector<SDL_Surface *> &images, const double scale, const int max_w, int &atlas_w,
+              int &atlas_h)
+    {
+        int x = 0, y = 0, shelf_h = 0;
+        atlas_w = 0;
+        for (int i = 0; i < int(Sprite::COUNT); ++i)
+        {
+            const bool white = i == int(Sprite::WHITE);
+            const int w = white ? WHITE_SIZE : max(1, int(images[i]->w * scale));
+            const int h = white ? WHITE_SIZE : max(1, int(images[i]->h * scale));
+            if (w > max_w)
+                return false;
+            if (x + w > max_w)
+            {
+                x = 0;
+                y += shelf_h + PADDING;
+                shelf_h = 0;
+            }
+            rects[i] = {x, y, w, h};
+            x += w + PADDING;
+            shelf_h = max(shelf_h, h);
+            atlas_w = max(atlas_w, x - PADDING);
+        }
+        atlas_h = y + shelf_h;
+        return true;
+    }
+
+    SDL_Texture *texture = nullptr;
+    int width = 0, height = 0;
+    // Места спрайтов в атласе
+    SDL_Rect rects[int(Sprite::COUNT)] = {};
+    // Прямоугольники текущего кадра и буферы вершин для них
+    vector<Quad> quads;
+    vector<SDL_Vertex> vertices;
+    vector<int> indices;
+};
@@ -0,0 +1,393 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "../Models/Position.h"
+#include "Score.h"
+
+// Пакетная оценка позиций для настройки оценки и подготовки данных.
+// Позиции хранятся в виде структуры массивов (PositionBatch): маски белых,
+// черных и дамок разных позиций лежат в отдельных массивах подряд, поэтому
+// ядро SIMD загружает маски сразу нескольких позиций одной командой.
+// Ядра: AVX2 (8 позиций за шаг), SSSE3 (4 позиции) и скалярное. Ядро
+// выбирается во время работы по возможностям процессора. Все ядра дают
+// тот же результат, что и Logic::calc_score, бит в бит: целые слагаемые
+// считаются точно, силы пешек с продвижением берутся из той же таблицы
+// (men_table), а операции с double выполняются в том же порядке
+// и без слияния умножения со сложением (FMA).
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define BATCH_EVAL_X86
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #endif
+#endif
+
+// Для GCC и Clang ядра компилируются со своим набором команд,
+// остальной код программы от этого не зависит
+#if defined(BATCH_EVAL_X86) && (defined(__GNUC__) || defined(__clang__))
+    #define BATCH_EVAL_TARGET(isa) __attribute__((target(isa)))
+#else
+    #define BATCH_EVAL_TARGET(isa)
+#endif
+
+// Позиции в виде структуры массивов
+struct PositionBatch
+{
+    std::vector<uint32_t> white, black, kings;
+
+    void add(const Position &pos)
+    {
+        white.push_back(pos.white);
+        black.push_back(pos.black);
+        kings.push_back(pos.kings);
+    }
+
+    size_t size() const
+    {
+        return white.size();
+    }
+
+    void clear()
+    {
+        white.clear();
+        black.clear();
+        kings.clear();
+    }
+};
+
+// Набор команд ядра пакетной оценки
+enum class SimdLevel
+{
+    SCALAR,
+    SSSE3,
+    AVX2
+};
+
+inline const char *simd_name(const SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::AVX2:
+        return "AVX2";
+    case SimdLevel::SSSE3:
+        return "SSSE3";
+    default:
+        return "scalar";
+    }
+}
+
+// Лучший набор команд, который поддерживают процессор и операционная система
+inline SimdLevel detect_simd_level()
+{
+#if defined(BATCH_EVAL_X86) && defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    const int max_leaf = info[0];
+    __cpuid(info, 1);
+    const bool ssse3 = (info[2] >> 9) & 1;
+    const bool osxsave = (info[2] >> 27) & 1;
+    const bool avx = (info[2] >> 28) & 1;
+    bool avx2 = false;
+    if (max_leaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6)
+    {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] >> 5) & 1;
+    }
+    return avx2 ? SimdLevel::AVX2 : ssse3 ? SimdLevel::SSSE3 : SimdLevel::SCALAR;
+#elif defined(BATCH_EVAL_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("ssse3"))
+        return SimdLevel::SSSE3;
+    return SimdLevel::SCALAR;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+inline SimdLevel simd_level()
+{
+    static const SimdLevel level = detect_simd_level();
+    return level;
+}
+
+// Оценка одной позиции из пакета (скалярное ядро и остаток пакета)
+inline double batch_score(const uint32_t white, const uint32_t black, const uint32_t kings,
+                          const bool first_bot_color, const bool potential)
+{
+    const uint32_t w_men = white & ~kings;
+    const uint32_t b_men = black & ~kings;
+    double w = popcount(w_men), b = popcount(b_men);
+    if (potential)
+    {
+        w = men_with_potential(w_men, true);
+        b = men_with_potential(b_men, false);
+    }
+    return score_position(w, popcount(white & kings), b, popcount(black & kings), first_bot_color, potential);
+}
+
+#ifdef BATCH_EVAL_X86
+// Каждый байт маски - две строки доски: младшая тетрада - строка 2j,
+// старшая - строка 2j + 1. Количество фигур в строке находится таблицей
+// по тетраде (pshufb). Из количеств по строкам складываются количество
+// фигур и номер таблицы сил пешек (men_table_index): количества - цифры
+// номера, байт дает две цифры, умножение байтов на веса с попарным
+// сложением (pmaddubsw) - четыре, а слов (pmaddwd) - восемь.
+// Силы пешек с продвижением загружаются из таблицы по номеру, поэтому
+// совпадают с men_with_potential бит в бит. Если у какой-то позиции шага
+// есть пешка на строке превращения (номера для нее нет), шаг оценивается
+// скалярным ядром.
+
+// Функции ядер компилируются с набором команд ядра (лямбды его
+// не наследуют), поэтому вспомогательные функции отдельные.
+
+// Количество фигур маски bb в строках 2j (low) и 2j + 1 (high) в байте j (8 позиций)
+BATCH_EVAL_TARGET("avx2")
+inline void batch_row_counts_avx2(const __m256i bb, __m256i &low, __m256i &high)
+{
+    const __m256i nibble_counts =
+        _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0F);
+    low = _mm256_shuffle_epi8(nibble_counts, _mm256_and_si256(bb, low_mask));
+    high = _mm256_shuffle_epi8(nibble_counts, _mm256_and_si256(_mm256_srli_epi16(bb, 4), low_mask));
+}
+
+// Количество фигур маски bb (8 позиций)
+BATCH_EVAL_TARGET("avx2")
+inline __m256i batch_count_avx2(const __m256i bb)
+{
+    __m256i low, high;
+    batch_row_counts_avx2(bb, low, high);
+    const __m256i sum16 = _mm256_maddubs_epi16(_mm256_add_epi8(low, high), _mm256_set1_epi8(1));
+    return _mm256_madd_epi16(sum16, _mm256_set1_epi16(1));
+}
+
+// Номер таблицы сил пешек для пешек bb (8 позиций, пешек на строке превращения нет)
+BATCH_EVAL_TARGET("avx2")
+inline __m256i batch_men_index_avx2(const __m256i bb, const bool white)
+{
+    __m256i low, high;
+    batch_row_counts_avx2(bb, low, high);
+    // Цифра строки с большим весом (у белых - строки 2j) умножается на 5
+    const __m256i major = white ? low : high, minor = white ? high : low;
+    const __m256i digits = _mm256_add_epi8(minor, _mm256_add_epi8(_mm256_slli_epi16(major, 2), major));
+    // Пары байтов - цифры по основанию 25, пары слов - по основанию 625
+    const __m256i pairs = _mm256_maddubs_epi16(digits, _mm256_set1_epi16(white ? 0x0119 : 0x1901));
+    return _mm256_madd_epi16(pairs, _mm256_set1_epi32(white ? 0x00010271 : 0x02710001));
+}
+
+// Четыре значения таблицы table по номерам index (маскированная форма
+// сбора с нулевым начальным значением: у обычной GCC предупреждает
+// о неинициализированном значении)
+BATCH_EVAL_TARGET("avx2")
+inline __m256d batch_gather_avx2(const double *table, const __m128i index)
+{
+    return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), table, index, _mm256_castsi256_pd(_mm256_set1_epi64x(-1)),
+                                    8);
+}
+
+// Оценка четырех позиций по количеству фигур и силам пешек
+// в том же порядке операций, что и score_position.
+// w_pot, b_pot - силы пешек с продвижением (только для potential)
+BATCH_EVAL_TARGET("avx2")
+inline void batch_score4_avx2(const __m128i wm, const __m128i wk, const __m128i bm, const __m128i bk,
+                              const __m256d w_pot, const __m256d b_pot, const bool first_bot_color,
+                              const bool potential, double *out)
+{
+    const __m256d zero = _mm256_setzero_pd();
+    __m256d w = potential ? w_pot : _mm256_cvtepi32_pd(wm);
+    __m256d wq = _mm256_cvtepi32_pd(wk);
+    __m256d b = potential ? b_pot : _mm256_cvtepi32_pd(bm);
+    __m256d bq = _mm256_cvtepi32_pd(bk);
+    if (!first_bot_color)
+    {
+        std::swap(w, b);
+        std::swap(wq, bq);
+    }
+    const __m256d q_coef = _mm256_set1_pd(potential ? 5 : 4);
+    __m256d res = _mm256_div_pd(_mm256_add_pd(b, _mm256_mul_pd(bq, q_coef)), _mm256_add_pd(w, _mm256_mul_pd(wq, q_coef)));
+    res = _mm256_blendv_pd(res, zero, _mm256_cmp_pd(_mm256_add_pd(b, bq), zero, _CMP_EQ_OQ));
+    res = _mm256_blendv_pd(res, _mm256_set1_pd(INF), _mm256_cmp_pd(_mm256_add_pd(w, wq), zero, _CMP_EQ_OQ));
+    _mm256_storeu_pd(out, res);
+}
+
+// Оценка позиций [0, n) с шагом 8 командами AVX2. Возвращает количество оцененных позиций.
+BATCH_EVAL_TARGET("avx2")
+inline size_t evaluate_batch_avx2(const uint32_t *white, const uint32_t *black, const uint32_t *kings,
+                                  const size_t n, const bool first_bot_color, const bool potential, double *scores)
+{
+    const double *w_table = potential ? men_table().white.data() : nullptr;
+    const double *b_table = potential ? men_table().black.data() : nullptr;
+    const __m256i w_promotion = _mm256_set1_epi32(int(WHITE_PROMOTION_ROW));
+    const __m256i b_promotion = _mm256_set1_epi32(int(BLACK_PROMOTION_ROW));
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m256i white_bb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(white + i));
+        const __m256i black_bb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(black + i));
+        const __m256i kings_bb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(kings + i));
+        const __m256i w_men_bb = _mm256_andnot_si256(kings_bb, white_bb);
+        const __m256i b_men_bb = _mm256_andnot_si256(kings_bb, black_bb);
+        __m256d w_pot[2] = {}, b_pot[2] = {};
+        if (potential)
+        {
+            const __m256i promoted =
+                _mm256_or_si256(_mm256_and_si256(w_men_bb, w_promotion), _mm256_and_si256(b_men_bb, b_promotion));
+            if (!_mm256_testz_si256(promoted, promoted))
+            {
+                for (size_t k = i; k < i + 8; ++k)
+                    scores[k] = batch_score(white[k], black[k], kings[k], first_bot_color, potential);
+                continue;
+            }
+            const __m256i w_index = batch_men_index_avx2(w_men_bb, true);
+            const __m256i b_index = batch_men_index_avx2(b_men_bb, false);
+            w_pot[0] = batch_gather_avx2(w_table, _mm256_castsi256_si128(w_index));
+            w_pot[1] = batch_gather_avx2(w_table, _mm256_extracti128_si256(w_index, 1));
+            b_pot[0] = batch_gather_avx2(b_table, _mm256_castsi256_si128(b_index));
+            b_pot[1] = batch_gather_avx2(b_table, _mm256_extracti128_si256(b_index, 1));
+        }
+        const __m256i wm = batch_count_avx2(w_men_bb);
+        const __m256i wk = batch_count_avx2(_mm256_and_si256(white_bb, kings_bb));
+        const __m256i bm = batch_count_avx2(b_men_bb);
+        const __m256i bk = batch_count_avx2(_mm256_and_si256(black_bb, kings_bb));
+        batch_score4_avx2(_mm256_castsi256_si128(wm), _mm256_castsi256_si128(wk), _mm256_castsi256_si128(bm),
+                          _mm256_castsi256_si128(bk), w_pot[0], b_pot[0], first_bot_color, potential, scores + i);
+        batch_score4_avx2(_mm256_extracti128_si256(wm, 1), _mm256_extracti128_si256(wk, 1),
+                          _mm256_extracti128_si256(bm, 1), _mm256_extracti128_si256(bk, 1), w_pot[1], b_pot[1],
+                          first_bot_color, potential, scores + i + 4);
+    }
+    return i;
+}
+
+// Количество фигур маски bb в строках 2j (low) и 2j + 1 (high) в байте j (4 позиции)
+BATCH_EVAL_TARGET("ssse3")
+inline void batch_row_counts_ssse3(const __m128i bb, __m128i &low, __m128i &high)
+{
+    const __m128i nibble_counts = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m128i low_mask = _mm_set1_epi8(0x0F);
+    low = _mm_shuffle_epi8(nibble_counts, _mm_and_si128(bb, low_mask));
+    high = _mm_shuffle_epi8(nibble_counts, _mm_and_si128(_mm_srli_epi16(bb, 4), low_mask));
+}
+
+// Количество фигур маски bb (4 позиции)
+BATCH_EVAL_TARGET("ssse3")
+inline __m128i batch_count_ssse3(const __m128i bb)
+{
+    __m128i low, high;
+    batch_row_counts_ssse3(bb, low, high);
+    const __m128i sum16 = _mm_maddubs_epi16(_mm_add_epi8(low, high), _mm_set1_epi8(1));
+    return _mm_madd_epi16(sum16, _mm_set1_epi16(1));
+}
+
+// Номер таблицы сил пешек для пешек bb (4 позиции), как в batch_men_index_avx2
+BATCH_EVAL_TARGET("ssse3")
+inline __m128i batch_men_index_ssse3(const __m128i bb, const bool white)
+{
+    __m128i low, high;
+    batch_row_counts_ssse3(bb, low, high);
+    const __m128i major = white ? low : high, minor = white ? high : low;
+    const __m128i digits = _mm_add_epi8(minor, _mm_add_epi8(_mm_slli_epi16(major, 2), major));
+    const __m128i pairs = _mm_maddubs_epi16(digits, _mm_set1_epi16(white ? 0x0119 : 0x1901));
+    return _mm_madd_epi16(pairs, _mm_set1_epi32(white ? 0x00010271 : 0x02710001));
+}
+
+// Оценка двух позиций (младшие 64 бита аргументов); выбор по маске - через and/andnot/or
+BATCH_EVAL_TARGET("ssse3")
+inline void batch_score2_ssse3(const __m128i wm, const __m128i wk, const __m128i bm, const __m128i bk,
+                               const __m128d w_pot, const __m128d b_pot, const bool first_bot_color,
+                               const bool potential, double *out)
+{
+    const __m128d zero = _mm_setzero_pd();
+    __m128d w = potential ? w_pot : _mm_cvtepi32_pd(wm);
+    __m128d wq = _mm_cvtepi32_pd(wk);
+    __m128d b = potential ? b_pot : _mm_cvtepi32_pd(bm);
+    __m128d bq = _mm_cvtepi32_pd(bk);
+    if (!first_bot_color)
+    {
+        std::swap(w, b);
+        std::swap(wq, bq);
+    }
+    const __m128d q_coef = _mm_set1_pd(potential ? 5 : 4);
+    __m128d res = _mm_div_pd(_mm_add_pd(b, _mm_mul_pd(bq, q_coef)), _mm_add_pd(w, _mm_mul_pd(wq, q_coef)));
+    const __m128d b_zero = _mm_cmpeq_pd(_mm_add_pd(b, bq), zero);
+    res = _mm_andnot_pd(b_zero, res);
+    const __m128d w_zero = _mm_cmpeq_pd(_mm_add_pd(w, wq), zero);
+    res = _mm_or_pd(_mm_and_pd(w_zero, _mm_set1_pd(INF)), _mm_andnot_pd(w_zero, res));
+    _mm_storeu_pd(out, res);
+}
+
+// Оценка позиций [0, n) с шагом 4 командами SSSE3. Возвращает количество оцененных позиций.
+// Команды сбора из памяти в SSSE3 нет, силы пешек загружаются из таблицы по одной.
+BATCH_EVAL_TARGET("ssse3")
+inline size_t evaluate_batch_ssse3(const uint32_t *white, const uint32_t *black, const uint32_t *kings,
+                                   const size_t n, const bool first_bot_color, const bool potential, double *scores)
+{
+    const double *w_table = potential ? men_table().white.data() : nullptr;
+    const double *b_table = potential ? men_table().black.data() : nullptr;
+    const __m128i w_promotion = _mm_set1_epi32(int(WHITE_PROMOTION_ROW));
+    const __m128i b_promotion = _mm_set1_epi32(int(BLACK_PROMOTION_ROW));
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128i white_bb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(white + i));
+        const __m128i black_bb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(black + i));
+        const __m128i kings_bb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(kings + i));
+        const __m128i w_men_bb = _mm_andnot_si128(kings_bb, white_bb);
+        const __m128i b_men_bb = _mm_andnot_si128(kings_bb, black_bb);
+        __m128d w_pot[2] = {}, b_pot[2] = {};
+        if (potential)
+        {
+            const __m128i promoted =
+                _mm_or_si128(_mm_and_si128(w_men_bb, w_promotion), _mm_and_si128(b_men_bb, b_promotion));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(promoted, _mm_setzero_si128())) != 0xFFFF)
+            {
+                for (size_t k = i; k < i + 4; ++k)
+                    scores[k] = batch_score(white[k], black[k], kings[k], first_bot_color, potential);
+                continue;
+            }
+            alignas(16) int32_t w_index[4], b_index[4];
+            _mm_store_si128(reinterpret_cast<__m128i *>(w_index), batch_men_index_ssse3(w_men_bb, true));
+            _mm_store_si128(reinterpret_cast<__m128i *>(b_index), batch_men_index_ssse3(b_men_bb, false));
+            w_pot[0] = _mm_setr_pd(w_table[w_index[0]], w_table[w_index[1]]);
+            w_pot[1] = _mm_setr_pd(w_table[w_index[2]], w_table[w_index[3]]);
+            b_pot[0] = _mm_setr_pd(b_table[b_index[0]], b_table[b_index[1]]);
+            b_pot[1] = _mm_setr_pd(b_table[b_index[2]], b_table[b_index[3]]);
+        }
+        const __m128i wm = batch_count_ssse3(w_men_bb);
+        const __m128i wk = batch_count_ssse3(_mm_and_si128(white_bb, kings_bb));
+        const __m128i bm = batch_count_ssse3(b_men_bb);
+        const __m128i bk = batch_count_ssse3(_mm_and_si128(black_bb, kings_bb));
+        batch_score2_ssse3(wm, wk, bm, bk, w_pot[0], b_pot[0], first_bot_color, potential, scores + i);
+        batch_score2_ssse3(_mm_srli_si128(wm, 8), _mm_srli_si128(wk, 8), _mm_srli_si128(bm, 8),
+                           _mm_srli_si128(bk, 8), w_pot[1], b_pot[1], first_bot_color, potential, scores + i + 2);
+    }
+    return i;
+}
+#endif
+
+// Оценивает все позиции batch для бота цвета first_bot_color (true - черные)
+// и записывает оценки в scores (batch.size() значений).
+// potential - режим "NumberAndPotential", иначе "NumberOnly".
+// level - набор команд; если процессор его не поддерживает, берется лучший доступный.
+inline void evaluate_batch(const PositionBatch &batch, const bool first_bot_color, const bool potential,
+                           double *scores, SimdLevel level = simd_level())
+{
+    if (level > simd_level())
+        level = simd_level();
+    const size_t n = batch.size();
+    size_t done = 0;
+#ifdef BATCH_EVAL_X86
+    if (level == SimdLevel::AVX2)
+        done = evaluate_batch_avx2(batch.white.data(), batch.black.data(), batch.kings.data(), n, first_bot_color,
+                                   potential, scores);
+    else if (level == SimdLevel::SSSE3)
+        done = evaluate_batch_ssse3(batch.white.data(), batch.black.data(), batch.kings.data(), n, first_bot_color,
+                                    potential, scores);
+#endif
+    for (size_t i = done; i < n; ++i)
+        scores[i] = batch_score(batch.white[i], batch.black[i], batch.kings[i], first_bot_color, potential);
+}
@@ -4,7 +4,11 @@
 #include <vector>
 
 #include "../Models/Move.h"
+#include "../Models/Position.h"
 #include "../Models/Project_path.h"
+#include "Atlas.h"
+#include "History.h"
+#include "Logger.h"
 
 #ifdef __APPLE__
     #include <SDL2/SDL.h>
@@ -16,10 +20,24 @@
 
 using namespace std;
 
-// Класс, отвечающий за отрисовку окна игры
+// Класс, отвечающий за отрисовку окна игры.
+// Сцена (фигуры, подсветка, итог партии) хранится в полях, и методы,
+// которые ее меняют, только отмечают, что кадр устарел. Кадр рисуется
+// один раз методом present() из цикла ожидания событий (Hand) перед тем,
+// как поток интерфейса заснет, поэтому несколько изменений после одного
+// нажатия дают один кадр, а SDL_RenderPresent с вертикальной синхронизацией
+// ограничивает частоту кадров частотой экрана.
 class Board
 {
 public:
+    // Статистика отрисовки: количество кадров и время их рисования
+    struct FrameStats
+    {
+        uint64_t frames = 0;
+        double total_ms = 0;
+        double max_ms = 0;
+    };
+
     Board() = default;
     Board(const unsigned int W, const unsigned int H) : W(W), H(H)
     {
@@ -66,24 +84,20 @@ public:
             return 1;
         }
 
-        // Загрузить текстуры
-        board = IMG_LoadTexture(ren, board_path.c_str());
-        w_piece = IMG_LoadTexture(ren, piece_white_path.c_str());
-        b_piece = IMG_LoadTexture(ren, piece_black_path.c_str());
-        w_queen = IMG_LoadTexture(ren, queen_white_path.c_str());
-        b_queen = IMG_LoadTexture(ren, queen_black_path.c_str());
-        back = IMG_LoadTexture(ren, back_path.c_str());
-        replay = IMG_LoadTexture(ren, replay_path.c_str());
-        if (!board || !w_piece || !b_piece || !w_queen || !b_queen || !back || !replay)
+        // Загрузить все картинки в атлас: после запуска диск не читается
+        const string atlas_error = atlas.load(
+            ren, {board_path, piece_white_path, piece_black_path, queen_white_path, queen_black_path, back_path,
+                  replay_path, white_path, black_path, draw_path});
+        if (!atlas_error.empty())
         {
-            print_exception("IMG_LoadTexture can't load main textures from " + textures_path);
+            print_exception(atlas_error);
             return 1;
         }
 
         // Перерисовать окно
         SDL_GetRendererOutputSize(ren, &W, &H);
         make_start_mtx();
-        rerender();
+        dirty = true;
         return 0;
     }
 
@@ -92,8 +106,6 @@ public:
     {
         // очистить историю
         game_results = -1;
-        history_mtx.clear();
-        history_beat_series.clear();
         // пересоздать начальное положение фигур
         make_start_mtx();
         // Очистить подсветку
@@ -104,18 +116,8 @@ public:
     // Передвинуть фигуру на доске 
     void move_piece(move_pos turn, const int beat_series = 0)
     {
-        if (turn.xb != -1)
-        {
-            // убрать с доски побитую фигуру
-            mtx[turn.xb][turn.yb] = 0;
-        }
-        move_piece(turn.x, turn.y, turn.x2, turn.y2, beat_series);
-    }
+        const POS_T i = turn.x, j = turn.y, i2 = turn.x2, j2 = turn.y2;
 
-    // Передвинуть фигуру на доске 
-    void move_piece(const POS_T i, const POS_T j, const POS_T i2, const POS_T j2, const int beat_series = 0)
-    {
-        
         // Проверка начальной позиции
         if (mtx[i2][j2])
         {
@@ -128,24 +130,38 @@ public:
             throw runtime_error("begin position is empty, can't move");
         }
 
-        if ((mtx[i][j] == 1 && i2 == 0) || (mtx[i][j] == 2 && i2 == 7))
+        // добавить в историю (до хода: история берет побитую фигуру с доски)
+        const bool promoted = (mtx[i][j] == 1 && i2 == 0) || (mtx[i][j] == 2 && i2 == 7);
+        history.push(square(i, j), square(i2, j2), turn.xb != -1 ? square(turn.xb, turn.yb) : -1, promoted,
+                     beat_series);
+
+        if (turn.xb != -1)
+        {
+            // убрать с доски побитую фигуру
+            mtx[turn.xb][turn.yb] = 0;
+        }
+        if (promoted)
             mtx[i][j] += 2; // фигура стала дамкой
 
         // переместить фигуру
         mtx[i2][j2] = mtx[i][j];
         drop_piece(i, j);
-        // добавить в историю
-        add_history(beat_series);
     }
 
-    // Убрать фигуру с доски и перерисовать
+    // Передвинуть фигуру на доске 
+    void move_piece(const POS_T i, const POS_T j, const POS_T i2, const POS_T j2, const int beat_series = 0)
+    {
+        move_piece(move_pos(i, j, i2, j2), beat_series);
+    }
+
+    // Убрать фигуру с доски
     void drop_piece(const POS_T i, const POS_T j)
     {
         mtx[i][j] = 0;
-        rerender();
+        dirty = true;
     }
 
-    // Перевести фигуру в дамки и перерисовать
+    // Перевести фигуру в дамки
     void turn_into_queen(const POS_T i, const POS_T j)
     {
         // Проверка, что фигура может стать дамкой
@@ -155,7 +171,7 @@ public:
         }
 
         mtx[i][j] += 2;
-        rerender();
+        dirty = true;
     }
 
     // Вернуть игровое поле
@@ -164,6 +180,12 @@ public:
         return mtx;
     }
 
+    // Вернуть позицию на игровом поле в упакованном виде
+    Position get_position() const
+    {
+        return Position::from_matrix(mtx);
+    }
+
     // Подсветить заданные клетки зеленой рамкой.
     // Применяется для выделения клеток, допустимых для
     // выбора хода 
@@ -174,7 +196,7 @@ public:
             POS_T x = pos.first, y = pos.second;
             is_highlighted_[x][y] = 1;
         }
-        rerender();
+        dirty = true;
     }
 
     // Очистить подсветку клеток
@@ -184,7 +206,7 @@ public:
         {
             is_highlighted_[i].assign(8, 0);
         }
-        rerender();
+        dirty = true;
     }
 
     // Подсветить клетку красной рамкой.
@@ -193,7 +215,7 @@ public:
     {
         active_x = x;
         active_y = y;
-        rerender();
+        dirty = true;
     }
 
     // Очистить подсветку активной фигуры
@@ -201,7 +223,7 @@ public:
     {
         active_x = -1;
         active_y = -1;
-        rerender();
+        dirty = true;
     }
 
     // Проверяет, подсвечена ли данная клетка
@@ -214,43 +236,76 @@ public:
     void rollback()
     {
         // Нужно учитывать, что один ход мог состоять из нескольких взятий
-        auto beat_series = max(1, *(history_beat_series.rbegin()));
-        while (beat_series-- && history_mtx.size() > 1)
-        {
-            history_mtx.pop_back();
-            history_beat_series.pop_back();
-        }
+        if (!history.can_undo())
+            return;
+        auto beat_series = max(1, history.last().beat_series());
+        while (beat_series-- && history.can_undo())
+            history.undo();
+        mtx = history.position().to_matrix();
         // Сбросить подсветку
-        mtx = *(history_mtx.rbegin());
         clear_highlight();
         clear_active();
     }
 
+    // Количество сделанных шагов партии (ход с серией взятий - несколько шагов)
+    size_t history_size() const
+    {
+        return history.size();
+    }
+
+    // Сколько последних ходов можно отменить (0 - без ограничения)
+    void set_undo_depth(const size_t moves)
+    {
+        history.set_undo_depth(moves);
+    }
+
+    // История партии
+    const GameHistory &get_history() const
+    {
+        return history;
+    }
+
     // Показать результат партии
     void show_final(const int res)
     {
         game_results = res;
-        rerender();
+        dirty = true;
     }
 
-    // Изменить размеры окна и перерисовать
+    // Изменить размеры окна
     void reset_window_size()
     {
         SDL_GetRendererOutputSize(ren, &W, &H);
+        dirty = true;
+    }
+
+    // Рисует кадр, если сцена изменилась после прошлого кадра.
+    // Возвращает true, если кадр нарисован.
+    bool present()
+    {
+        if (!dirty || !ren)
+            return false;
+        dirty = false;
+        const uint64_t start = SDL_GetPerformanceCounter();
         rerender();
+        const double ms = double(SDL_GetPerformanceCounter() - start) * 1000 / SDL_GetPerformanceFrequency();
+        ++frame_stats.frames;
+        frame_stats.total_ms += ms;
+        frame_stats.max_ms = max(frame_stats.max_ms, ms);
+        return true;
+    }
+
+    // Статистика отрисовки с начала программы
+    const FrameStats &get_frame_stats() const
+    {
+        return frame_stats;
     }
 
     // Выход
     void quit()
     {
         // Освободить все выделенные ресурсы
-        SDL_DestroyTexture(board);
-        SDL_DestroyTexture(w_piece);
-        SDL_DestroyTexture(b_piece);
-        SDL_DestroyTexture(w_queen);
-        SDL_DestroyTexture(b_queen);
-        SDL_DestroyTexture(back);
-        SDL_DestroyTexture(replay);
+        atlas.release();
         SDL_DestroyRenderer(ren);
         SDL_DestroyWindow(win);
         SDL_Quit();
@@ -264,14 +319,6 @@ public:
     }
 
 private:
-    // Добавляет текущий ход в историю, для возможности обратной перемотки
-    void add_history(const int beat_series = 0)
-    {
-        history_mtx.push_back(mtx);
-        // учет количества взятий
-        history_beat_series.push_back(beat_series);
-    }
-
     // Делает начальное расположение фигур
     void make_start_mtx()
     {
@@ -286,15 +333,16 @@ private:
                     mtx[i][j] = 1;
             }
         }
-        add_history();
+        history.reset(Position::from_matrix(mtx));
     }
 
-    // Функция для перерисовки текстур
+    // Рисует кадр по текущей сцене (вызывается только из present()).
+    // Кадр собирается из спрайтов атласа и рисуется одним вызовом.
     void rerender()
     {
+        atlas.clear();
         // Рисовать доску
-        SDL_RenderClear(ren);
-        SDL_RenderCopy(ren, board, NULL, NULL);
+        atlas.add(Sprite::BOARD, {0, 0, W, H});
 
         // Рисовать фигуры
         for (POS_T i = 0; i < 8; ++i)
@@ -307,102 +355,78 @@ private:
                 int hpos = H * (i + 1) / 10 + H / 120;
                 SDL_Rect rect{ wpos, hpos, W / 12, H / 12 };
 
-                SDL_Texture* piece_texture;
+                Sprite piece_sprite;
                 if (mtx[i][j] == 1)
-                    piece_texture = w_piece;
+                    piece_sprite = Sprite::WHITE_PIECE;
                 else if (mtx[i][j] == 2)
-                    piece_texture = b_piece;
+                    piece_sprite = Sprite::BLACK_PIECE;
                 else if (mtx[i][j] == 3)
-                    piece_texture = w_queen;
+                    piece_sprite = Sprite::WHITE_QUEEN;
                 else
-                    piece_texture = b_queen;
+                    piece_sprite = Sprite::BLACK_QUEEN;
 
-                SDL_RenderCopy(ren, piece_texture, NULL, &rect);
+                atlas.add(piece_sprite, rect);
             }
         }
 
-        // Рисовать подсветку клеток
-        SDL_SetRenderDrawColor(ren, 0, 255, 0, 0);
-        const double scale = 2.5;
-        SDL_RenderSetScale(ren, scale, scale);
+        // Рисовать подсветку клеток (толщина рамки - как у прежней линии при масштабе 2.5)
+        const int frame = 3;
         for (POS_T i = 0; i < 8; ++i)
         {
             for (POS_T j = 0; j < 8; ++j)
             {
                 if (!is_highlighted_[i][j])
                     continue;
-                SDL_Rect cell{ int(W * (j + 1) / 10 / scale), int(H * (i + 1) / 10 / scale), int(W / 10 / scale),
-                              int(H / 10 / scale) };
-                SDL_RenderDrawRect(ren, &cell);
+                SDL_Rect cell{ W * (j + 1) / 10, H * (i + 1) / 10, W / 10, H / 10 };
+                atlas.add_frame(cell, frame, {0, 255, 0, 255});
             }
         }
 
         // Рисовать подсветку активной фигуры
         if (active_x != -1)
         {
-            SDL_SetRenderDrawColor(ren, 255, 0, 0, 0);
-            SDL_Rect active_cell{ int(W * (active_y + 1) / 10 / scale), int(H * (active_x + 1) / 10 / scale),
-                                 int(W / 10 / scale), int(H / 10 / scale) };
-            SDL_RenderDrawRect(ren, &active_cell);
+            SDL_Rect active_cell{ W * (active_y + 1) / 10, H * (active_x + 1) / 10, W / 10, H / 10 };
+            atlas.add_frame(active_cell, frame, {255, 0, 0, 255});
         }
-        SDL_RenderSetScale(ren, 1, 1);
 
         // Рисовать стрелки
-        SDL_Rect rect_left{ W / 40, H / 40, W / 15, H / 15 };
-        SDL_RenderCopy(ren, back, NULL, &rect_left);
-        SDL_Rect replay_rect{ W * 109 / 120, H / 40, W / 15, H / 15 };
-        SDL_RenderCopy(ren, replay, NULL, &replay_rect);
+        atlas.add(Sprite::BACK, { W / 40, H / 40, W / 15, H / 15 });
+        atlas.add(Sprite::REPLAY, { W * 109 / 120, H / 40, W / 15, H / 15 });
 
         // Рисовать итог партии
         if (game_results != -1)
         {
-            string result_path = draw_path;
+            Sprite result_sprite = Sprite::DRAW;
             if (game_results == 1)
-                result_path = white_path;
+                result_sprite = Sprite::WHITE_WINS;
             else if (game_results == 2)
-                result_path = black_path;
-            SDL_Texture* result_texture = IMG_LoadTexture(ren, result_path.c_str());
-            if (result_texture == nullptr)
-            {
-                print_exception("IMG_LoadTexture can't load game result picture from " + result_path);
-                return;
-            }
-            SDL_Rect res_rect{ W / 5, H * 3 / 10, W * 3 / 5, H * 2 / 5 };
-            SDL_RenderCopy(ren, result_texture, NULL, &res_rect);
-            SDL_DestroyTexture(result_texture);
+                result_sprite = Sprite::BLACK_WINS;
+            atlas.add(result_sprite, { W / 5, H * 3 / 10, W * 3 / 5, H * 2 / 5 });
         }
 
+        SDL_RenderClear(ren);
+        if (!atlas.draw(ren))
+            print_exception("SDL_RenderGeometry can't draw frame");
+
+        // На macOS окно обновляется после обработки событий: после кадра
+        // поток интерфейса сразу ждет события (Hand), задержка не нужна
         SDL_RenderPresent(ren);
-        // next rows for mac os
-        SDL_Delay(10);
-        SDL_Event windowEvent;
-        SDL_PollEvent(&windowEvent);
     }
 
     // Вывод сообщения об ошибке
     void print_exception(const string& text) {
-        ofstream fout(project_path + "log.txt", ios_base::app);
-        fout << "Error: " << text << ". "<< SDL_GetError() << endl;
-        fout.close();
+        game_log().log(LogLevel::FAILURE, text + ". " + SDL_GetError(), {{"sdl_error", SDL_GetError()}});
     }
 
   public:
     int W = 0;
     int H = 0;
-    // history of boards
-    vector<vector<vector<POS_T>>> history_mtx;
 
   private:
     SDL_Window *win = nullptr;
     SDL_Renderer *ren = nullptr;
-    // textures
-    SDL_Texture *board = nullptr;
-    SDL_Texture *w_piece = nullptr;
-    SDL_Texture *b_piece = nullptr;
-    SDL_Texture *w_queen = nullptr;
-    SDL_Texture *b_queen = nullptr;
-    SDL_Texture *back = nullptr;
-    SDL_Texture *replay = nullptr;
+    // textures (all pictures in one atlas)
+    TextureAtlas atlas;
     // texture files names
     const string textures_path = project_path + "Textures/";
     const string board_path = textures_path + "board.png";
@@ -424,6 +448,9 @@ private:
     // matrix of possible moves
     // 1 - white, 2 - black, 3 - white queen, 4 - black queen
     vector<vector<POS_T>> mtx = vector<vector<POS_T>>(8, vector<POS_T>(8, 0));
-    // series of beats for each move
-    vector<int> history_beat_series;
+    // history of moves for rollback
+    GameHistory history;
+    // сцена изменилась, нужен новый кадр
+    bool dirty = false;
+    FrameStats frame_stats;
 };
@@ -0,0 +1,111 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "TTable.h"
+
+// Ход из дебютной книги
+struct BookMove
+{
+    // Ключ позиции (hash_position с учетом очередности хода)
+    uint64_t key = 0;
+    // Маска клеток побитых фигур
+    uint32_t beaten = 0;
+    // Начальная и конечная клетки хода
+    int8_t from = -1, to = -1;
+    // Вес хода: чем больше, тем чаще он выбирается
+    uint16_t weight = 0;
+};
+static_assert(sizeof(BookMove) == 16, "book entry must be 16 bytes");
+
+// Ключ позиции pos с ходом игрока color для дебютной книги
+inline uint64_t book_key(const Position &pos, const bool color)
+{
+    return hash_position(pos) ^ (color ? zobrist().black_move : 0);
+}
+
+// Дебютная книга: отсортированный по ключу массив ходов в файле,
+// отображенном в память. Поиск хода - двоичный поиск по ключу.
+// Файл: заголовок (метка, версия, число ходов) и ходы BookMove.
+class Book
+{
+  public:
+    // Открывает книгу path. Если файла нет, книга пустая.
+    explicit Book(const std::string &path)
+    {
+        if (!file.open(path))
+            return;
+        Header header;
+        if (file.size() < sizeof(Header))
+            throw std::runtime_error("opening book is too short: " + path);
+        memcpy(&header, file.data(), sizeof(Header));
+        if (memcmp(header.magic, MAGIC, 4) || header.version != VERSION ||
+            file.size() != sizeof(Header) + header.count * sizeof(BookMove))
+            throw std::runtime_error("bad opening book file: " + path);
+        moves = reinterpret_cast<const BookMove *>(file.data() + sizeof(Header));
+        count = header.count;
+    }
+
+    Book(const Book &) = delete;
+    Book &operator=(const Book &) = delete;
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    // Все ходы книги для позиции с ключом key
+    std::pair<const BookMove *, const BookMove *> find(const uint64_t key) const
+    {
+        auto less = [](const BookMove &move, const uint64_t k) { return move.key < k; };
+        const BookMove *first = std::lower_bound(moves, moves + count, key, less);
+        const BookMove *last = first;
+        while (last != moves + count && last->key == key)
+            ++last;
+        return {first, last};
+    }
+
+    // Запись ходов в формат файла. Ходы сортируются по ключу,
+    // а для одной позиции - по убыванию веса.
+    static std::vector<uint8_t> encode(std::vector<BookMove> book_moves)
+    {
+        std::sort(book_moves.begin(), book_moves.end(), [](const BookMove &a, const BookMove &b) {
+            return a.key != b.key ? a.key < b.key : a.weight > b.weight;
+        });
+        Header header;
+        memcpy(header.magic, MAGIC, 4);
+        header.version = VERSION;
+        header.count = book_moves.size();
+        std::vector<uint8_t> res(sizeof(Header) + book_moves.size() * sizeof(BookMove));
+        memcpy(res.data(), &header, sizeof(Header));
+        if (!book_moves.empty())
+            memcpy(res.data() + sizeof(Header), book_moves.data(), book_moves.size() * sizeof(BookMove));
+        return res;
+    }
+
+  private:
+    static constexpr const char *MAGIC = "CKBK";
+    static const uint32_t VERSION = 1;
+
+    // Заголовок файла
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t count;
+    };
+
+    MappedFile file;
+    const BookMove *moves = nullptr;
+    size_t count = 0;
+};
@@ -1,7 +1,9 @@
 #pragma once
 #include <fstream>
+#include <string>
 #include <nlohmann/json.hpp>
 using json = nlohmann::json;
+using namespace std;
 
 #include "../Models/Project_path.h"
 
@@ -33,6 +35,13 @@ class Config
         return config[setting_dir][setting_name];
     }
 
+    // Изменяет настройку только в памяти, файл не меняется.
+    // Нужно утилитам, которые запускают бота с другими настройками.
+    void set(const string &setting_dir, const string &setting_name, const json &value)
+    {
+        config[setting_dir][setting_name] = value;
+    }
+
   private:
     json config;
 };
@@ -1,20 +1,27 @@
 #pragma once
 #include <chrono>
+#include <ctime>
+#include <fstream>
 #include <thread>
 
 #include "../Models/Project_path.h"
 #include "Board.h"
 #include "Config.h"
 #include "Hand.h"
+#include "Logger.h"
 #include "Logic.h"
+#include "Pdn.h"
+#include "Ponder.h"
 
 class Game
 {
   public:
-    Game() : board(config("WindowSize", "Width"), config("WindowSize", "Hight")), hand(&board), logic(&board, &config)
+    Game() : board(config("WindowSize", "Width"), config("WindowSize", "Hight")), hand(&board), logic(&config)
     {
-        ofstream fout(project_path + "log.txt", ios_base::trunc);
-        fout.close();
+        configure_log();
+        const string search_log_path = config("Bot", "SearchLog");
+        if (!search_log_path.empty())
+            search_log = make_unique<Logger>(project_path + search_log_path, true);
     }
 
     // to start checkers
@@ -27,8 +34,9 @@ class Game
             // если нужно начать сначала
             // то перезагрузить настройки
             // и перерисовать доску
-            logic = Logic(&board, &config);
+            logic = Logic(&config);
             config.reload();
+            configure_log();
             board.redraw();
         }
         else
@@ -37,6 +45,7 @@ class Game
             board.start_draw();
         }
         is_replay = false; // сбрасываем этот флаг
+        board.set_undo_depth(config("Game", "UndoDepth"));
 
         int turn_num = -1; // номер хода
         bool is_quit = false; // флаг выхода из программы
@@ -47,7 +56,7 @@ class Game
         {
             beat_series = 0;
             // найти доступные ходы
-            logic.find_turns(turn_num % 2);
+            logic.find_turns(turn_num % 2, board.get_position());
             // если нет доступных ходов, то закончить
             if (logic.turns.empty())
                 break;
@@ -59,8 +68,14 @@ class Game
             {
                 // Ход человека
 
+                // Пока человек думает, бот обдумывает ответы на его ходы
+                const string bot_side = (1 - turn_num % 2) ? "Black" : "White";
+                if (config("Bot", "Ponder") && config("Bot", "Is" + bot_side + "Bot"))
+                    ponder.start(logic, turn_num % 2, board.get_position(), config("Bot", bot_side + "BotLevel"));
+
                 // получить ответ от UI
                 auto resp = player_turn(turn_num % 2);
+                ponder.stop();
                 
                 if (resp == Response::QUIT)
                 {
@@ -78,7 +93,7 @@ class Game
                 {
                     // Один ход назад
                     if (config("Bot", string("Is") + string((1 - turn_num % 2) ? "Black" : "White") + string("Bot")) &&
-                        !beat_series && board.history_mtx.size() > 2)
+                        !beat_series && board.history_size() > 1)
                     {
                         board.rollback();
                         --turn_num;
@@ -97,11 +112,20 @@ class Game
 
         // Запись в лог общего времени игры
         auto end = chrono::steady_clock::now();
-        ofstream fout(project_path + "log.txt", ios_base::app);
-        fout << "Game time: " << (int)chrono::duration<double, milli>(end - start).count() << " millisec\n";
-        fout.close();
+        const int game_ms = (int)chrono::duration<double, milli>(end - start).count();
+        game_log().log(LogLevel::INFO, "Game time: " + to_string(game_ms) + " millisec",
+                       {{"game_ms", game_ms}, {"turns", turn_num}});
+        // Статистика отрисовки: сколько кадров нарисовано и за какое время
+        const Board::FrameStats &frames = board.get_frame_stats();
+        game_log().log(LogLevel::INFO,
+                       "Frames: " + to_string(frames.frames) + ", average " +
+                           to_string(frames.total_ms / max<uint64_t>(frames.frames, 1)) + " millisec, max " +
+                           to_string(frames.max_ms) + " millisec",
+                       {{"frames", frames.frames}, {"frame_total_ms", frames.total_ms}, {"frame_max_ms", frames.max_ms}});
 
         // Либо играть заново либо выйти из игры
+        if (is_replay || is_quit)
+            save_pdn("*"); // партия не закончена
         if (is_replay)
             return play();
         if (is_quit)
@@ -118,6 +142,7 @@ class Game
             res = 1; // белые
         }
         board.show_final(res);
+        save_pdn(res == 1 ? "1-0" : res == 2 ? "0-1" : "1/2-1/2");
 
         // Либо играть заново либо выйти из игры
         auto resp = hand.wait();
@@ -141,15 +166,28 @@ class Game
         // "обдумывание". Кроме того, без задержки человеку 
         // сложно понять, что сделал бот, если был ход,
         // состоящий из многих взятий.
-        auto delay_ms = config("Bot", "BotDelayMS");
+        const Uint32 delay_ms = config("Bot", "BotDelayMS");
         
-        // Запуск задержки в отдельном потоке.
-        // Основной поток в это время выполняет поиск лучшего хода.
-        thread th(SDL_Delay, delay_ms);
+        // Поиск хода в отдельном потоке: когда ход найден, поток кладет
+        // событие в очередь окна, а поток интерфейса до этого спит
+        // в ожидании событий и перерисовывает окно при изменении размера.
+        // Задержка ограничивает время хода снизу, а BotTimeLimitMS,
+        // если он задан, ограничивает время поиска сверху.
         // Определение лучшего хода для бота.
-        // Один ход может состоять из серии взятий 
-        auto turns = logic.find_best_turns(color);
-        th.join(); // ожидание завершения потока задержки
+        // Один ход может состоять из серии взятий.
+        // Если ответ на ход человека уже обдуман, поиск не нужен.
+        const Position pos = board.get_position();
+        const Ponder::Reply *pondered = ponder.find(color, pos, logic.Max_depth);
+        // ГПСЧ бота продвигается так же, как при поиске этого ответа
+        if (pondered)
+            logic.set_random_engine(pondered->rand_eng);
+        vector<move_pos> turns;
+        thread search([&]() {
+            turns = pondered ? pondered->series : logic.find_best_turns(color, pos);
+            Hand::notify_bot_move();
+        });
+        hand.wait_bot(delay_ms);
+        search.join();
 
         bool is_first = true;
         // Поочередное выполнение каждой фазы хода.
@@ -160,7 +198,7 @@ class Game
             {
                 // Делать задержку перед каждой фазой хода, кроме
                 // первой, для которой задержка уже была реализована
-                SDL_Delay(delay_ms);
+                hand.wait_bot(delay_ms, false);
             }
             is_first = false;
             // увеличение счетчика взятых фигур
@@ -171,9 +209,23 @@ class Game
 
         // Запись в лог общего времени хода бота
         auto end = chrono::steady_clock::now();
-        ofstream fout(project_path + "log.txt", ios_base::app);
-        fout << "Bot turn time: " << (int)chrono::duration<double, milli>(end - start).count() << " millisec\n";
-        fout.close();
+        const int turn_ms = (int)chrono::duration<double, milli>(end - start).count();
+        game_log().log(LogLevel::INFO,
+                       "Bot turn time: " + to_string(turn_ms) + " millisec" + (pondered ? " (pondered)" : ""),
+                       {{"turn_ms", turn_ms}, {"color", color ? "black" : "white"}, {"pondered", pondered != nullptr}});
+
+        // Статистика поиска - строка JSON в журнале поиска
+        // (обдуманный ответ и ход из дебютной книги без поиска не записываются)
+        if (search_log && !pondered && !logic.stats.iterations.empty())
+        {
+            json line = {{"color", color ? "black" : "white"},
+                         {"level", logic.Max_depth},
+                         {"scoring", config("Bot", "BotScoringType")},
+                         {"optimization", config("Bot", "Optimization")},
+                         {"threads", config("Bot", "Threads")}};
+            line.update(logic.stats_json());
+            search_log->write(line.dump());
+        }
     }
 
     // Ход человека
@@ -278,7 +330,7 @@ class Game
         while (true)
         {
             // найти дальнейшие допустимые ходы
-            logic.find_turns(pos.x2, pos.y2);
+            logic.find_turns(pos.x2, pos.y2, board.get_position());
             // если среди них нет взятия, то закончить
             if (!logic.have_beats)
                 break;
@@ -336,11 +388,42 @@ class Game
         return Response::OK;
     }
 
+    // Дописывает партию в файл PdnFile из настроек (если он задан и в партии были ходы)
+    void save_pdn(const string &result)
+    {
+        const string pdn_path = config("Game", "PdnFile");
+        if (pdn_path.empty() || board.history_size() == 0)
+            return;
+        auto player = [this](const string &side) {
+            if (!config("Bot", "Is" + side + "Bot"))
+                return string("Human");
+            return "Bot level " + to_string(int(config("Bot", side + "BotLevel")));
+        };
+        const time_t now = time(nullptr);
+        char date[16];
+        strftime(date, sizeof(date), "%Y.%m.%d", localtime(&now));
+        ofstream fout(project_path + pdn_path, ios_base::app);
+        fout << pdn_from_history(
+            board.get_history(),
+            {{"Event", "Checkers"}, {"Date", date}, {"White", player("White")}, {"Black", player("Black")}}, result);
+        if (!fout)
+            game_log().log(LogLevel::WARNING, "Can't write game to " + pdn_path, {{"pdn_file", pdn_path}});
+    }
+
+    // Уровень и формат общего журнала из настроек
+    void configure_log()
+    {
+        game_log().configure(log_level_from_name(config("Game", "LogLevel")), config("Game", "LogFormat") == "json");
+    }
+
   private:
     Config config;
     Board board;
     Hand hand;
     Logic logic;
+    Ponder ponder;
+    // Журнал статистики поиска (nullptr, если выключен)
+    unique_ptr<Logger> search_log;
     int beat_series = 0;
     bool is_replay = false;
 };
@@ -6,6 +6,13 @@
 #include "Board.h"
 
 // methods for hands
+// Все ожидания блокирующие (SDL_WaitEvent): пока человек думает,
+// поток интерфейса спит и не занимает ядро, нужное поиску бота.
+// Перед каждым ожиданием рисуется кадр, если доска изменилась
+// (Board::present), так что это и есть цикл отрисовки.
+// Ход бота, найденный в другом потоке, приходит в ту же очередь
+// событием bot_move_event(), поэтому окно отвечает на изменение
+// размера и во время поиска.
 class Hand
 {
   public:
@@ -13,6 +20,62 @@ class Hand
     {
     }
 
+    // Тип пользовательского события SDL "бот нашел ход"
+    static Uint32 bot_move_event()
+    {
+        static const Uint32 type = []() {
+            const Uint32 registered = SDL_RegisterEvents(1);
+            return registered == Uint32(-1) ? Uint32(SDL_USEREVENT) : registered;
+        }();
+        return type;
+    }
+
+    // Сообщает потоку интерфейса, что бот нашел ход (из любого потока)
+    static void notify_bot_move()
+    {
+        SDL_Event event;
+        SDL_zero(event);
+        event.type = bot_move_event();
+        SDL_PushEvent(&event);
+    }
+
+    // Ожидание хода бота: возвращается, когда придет событие bot_move_event(),
+    // но не раньше, чем через min_ms. Если wait_move == false, то это просто
+    // пауза min_ms. Во время ожидания окно перерисовывается при изменении размера,
+    // нажатия на доску игнорируются, а закрытие окна возвращается в очередь,
+    // чтобы его обработало следующее ожидание отклика человека.
+    void wait_bot(const Uint32 min_ms, const bool wait_move = true) const
+    {
+        const Uint32 deadline = SDL_GetTicks() + min_ms;
+        bool moved = !wait_move;
+        bool quit = false;
+        SDL_Event windowEvent;
+        while (true)
+        {
+            const Uint32 now = SDL_GetTicks();
+            if (moved && SDL_TICKS_PASSED(now, deadline))
+                break;
+            board->present();
+            // Пока хода нет, ждать без ограничения времени: задержка
+            // нужна только, если ход найден быстрее
+            if (!(moved ? SDL_WaitEventTimeout(&windowEvent, int(deadline - now)) : SDL_WaitEvent(&windowEvent)))
+                continue;
+            if (windowEvent.type == bot_move_event())
+                moved = true;
+            else if (windowEvent.type == SDL_QUIT)
+                quit = true;
+            else if (windowEvent.type == SDL_WINDOWEVENT && windowEvent.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+                board->reset_window_size();
+        }
+        if (quit)
+        {
+            SDL_Event event;
+            SDL_zero(event);
+            event.type = SDL_QUIT;
+            SDL_PushEvent(&event);
+        }
+    }
+
     // Ожидание отклика в ходе партии.
     // Возвращает отклик игрока-человеа в виде кортежа,
     // где первый элемент это отклик (Response), а два следующих
@@ -25,59 +88,63 @@ class Hand
         int xc = -1, yc = -1;
         while (true)
         {
-            // Опрос событий окна
-            if (SDL_PollEvent(&windowEvent))
+            // Нарисовать изменения доски и ждать события окна
+            board->present();
+            if (!SDL_WaitEvent(&windowEvent))
             {
-                switch (windowEvent.type)
-                {
-                case SDL_QUIT:
-                    // Человек закрыл окно игры
-                    resp = Response::QUIT;
-                    break;
-                case SDL_MOUSEBUTTONDOWN:
-                    // Человек нажал кнопку мыши
+                // Очередь событий сломана, ждать бесполезно
+                resp = Response::QUIT;
+                break;
+            }
+            switch (windowEvent.type)
+            {
+            case SDL_QUIT:
+                // Человек закрыл окно игры
+                resp = Response::QUIT;
+                break;
+            case SDL_MOUSEBUTTONDOWN:
+                // Человек нажал кнопку мыши
 
-                    // Координаты в пространстве окна
-                    x = windowEvent.motion.x;
-                    y = windowEvent.motion.y;
+                // Координаты в пространстве окна
+                x = windowEvent.motion.x;
+                y = windowEvent.motion.y;
 
-                    // Координаты в пространстве доски
-                    xc = int(y / (board->H / 10) - 1);
-                    yc = int(x / (board->W / 10) - 1);
+                // Координаты в пространстве доски
+                xc = int(y / (board->H / 10) - 1);
+                yc = int(x / (board->W / 10) - 1);
 
-                    if (xc == -1 && yc == -1 && board->history_mtx.size() > 1)
-                    {
-                        // Человек нажал кнопку "BACK"
-                        resp = Response::BACK;
-                    }
-                    else if (xc == -1 && yc == 8)
-                    {
-                        // Человек нажал кнопку "REPLAY"
-                        resp = Response::REPLAY;
-                    }
-                    else if (xc >= 0 && xc < 8 && yc >= 0 && yc < 8)
-                    {
-                        // Человек нажал клетку на доске
-                        resp = Response::CELL;
-                    }
-                    else
-                    {
-                        xc = -1;
-                        yc = -1;
-                    }
-                    break;
-                case SDL_WINDOWEVENT:
-                    // Если изменен размер окна
-                    if (windowEvent.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
-                    {
-                        // перерисовать доску
-                        board->reset_window_size();
-                        break;
-                    }
+                if (xc == -1 && yc == -1 && board->history_size() > 0)
+                {
+                    // Человек нажал кнопку "BACK"
+                    resp = Response::BACK;
                 }
-                if (resp != Response::OK)
+                else if (xc == -1 && yc == 8)
+                {
+                    // Человек нажал кнопку "REPLAY"
+                    resp = Response::REPLAY;
+                }
+                else if (xc >= 0 && xc < 8 && yc >= 0 && yc < 8)
+                {
+                    // Человек нажал клетку на доске
+                    resp = Response::CELL;
+                }
+                else
+                {
+                    xc = -1;
+                    yc = -1;
+                }
+                break;
+            case SDL_WINDOWEVENT:
+                // Если изменен размер окна
+                if (windowEvent.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+                {
+                    // перерисовать доску
+                    board->reset_window_size();
                     break;
+                }
             }
+            if (resp != Response::OK)
+                break;
         }
         return {resp, xc, yc};
     }
@@ -91,29 +158,33 @@ class Hand
         Response resp = Response::OK;
         while (true)
         {
-            if (SDL_PollEvent(&windowEvent))
+            board->present();
+            if (!SDL_WaitEvent(&windowEvent))
             {
-                switch (windowEvent.type)
-                {
-                case SDL_QUIT:
-                    resp = Response::QUIT;
-                    break;
-                case SDL_WINDOWEVENT_SIZE_CHANGED:
+                resp = Response::QUIT;
+                break;
+            }
+            switch (windowEvent.type)
+            {
+            case SDL_QUIT:
+                resp = Response::QUIT;
+                break;
+            case SDL_WINDOWEVENT:
+                if (windowEvent.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
                     board->reset_window_size();
-                    break;
-                case SDL_MOUSEBUTTONDOWN: {
-                    int x = windowEvent.motion.x;
-                    int y = windowEvent.motion.y;
-                    int xc = int(y / (board->H / 10) - 1);
-                    int yc = int(x / (board->W / 10) - 1);
-                    if (xc == -1 && yc == 8)
-                        resp = Response::REPLAY;
-                }
                 break;
-                }
-                if (resp != Response::OK)
-                    break;
+            case SDL_MOUSEBUTTONDOWN: {
+                int x = windowEvent.motion.x;
+                int y = windowEvent.motion.y;
+                int xc = int(y / (board->H / 10) - 1);
+                int yc = int(x / (board->W / 10) - 1);
+                if (xc == -1 && yc == 8)
+                    resp = Response::REPLAY;
             }
+            break;
+            }
+            if (resp != Response::OK)
+                break;
         }
         return resp;
     }
@@ -0,0 +1,228 @@
+#pragma once
+#include <stdint.h>
+#include <stdexcept>
+#include <vector>
+
+#include "../Models/Position.h"
+
+using namespace std;
+
+// Шаг партии: перемещение одной фигуры, возможно со взятием, в 4 байтах.
+// Ход со серией взятий записывается несколькими шагами.
+struct HistoryStep
+{
+    // Клетки (номера 0..31, см. Position) начала и конца перемещения
+    uint8_t from = 0;
+    uint8_t to = 0;
+    // Побитая фигура: клетка в младших 5 битах и тип фигуры (1..4) в старших,
+    // 0 - шаг без взятия
+    uint8_t captured = 0;
+    // Номер взятия в серии (0 - ход без взятия), старший бит - фигура стала дамкой
+    uint8_t series = 0;
+
+    bool is_capture() const
+    {
+        return captured != 0;
+    }
+
+    int captured_square() const
+    {
+        return captured & 31;
+    }
+
+    POS_T captured_type() const
+    {
+        return POS_T(captured >> 5);
+    }
+
+    bool promoted() const
+    {
+        return (series & 0x80) != 0;
+    }
+
+    int beat_series() const
+    {
+        return series & 0x7F;
+    }
+};
+
+// История партии для перемотки ходов назад и вперед.
+// Хранится начальная позиция и упакованные шаги (4 байта на шаг),
+// а каждые CHECKPOINT_INTERVAL шагов - упакованная позиция (12 байт),
+// с которой восстанавливается любая позиция партии не более чем
+// за CHECKPOINT_INTERVAL шагов. Отмена и повтор шага делаются
+// на текущей позиции без восстановления: в шаге хранится все,
+// что нужно, чтобы его отменить.
+// Отмененные шаги остаются в истории, пока не сделан новый шаг.
+// Если задана глубина отмены (set_undo_depth), то старые шаги складываются
+// в начальную позицию целыми интервалами между сохраненными позициями,
+// и память истории не растет с длиной партии.
+class GameHistory
+{
+  public:
+    // Шагов между сохраненными позициями
+    static const size_t CHECKPOINT_INTERVAL = 64;
+
+    // Начать историю с позиции start
+    void reset(const Position &start)
+    {
+        steps_.clear();
+        checkpoints.assign(1, start);
+        current = start;
+        cursor = 0;
+        folded_moves_ = 0;
+    }
+
+    // Сколько последних ходов должно оставаться в истории для отмены
+    // (0 - хранить всю партию). Более старые ходы забываются.
+    void set_undo_depth(const size_t moves)
+    {
+        undo_depth = moves;
+    }
+
+    // Количество ходов, сложенных в начальную позицию истории
+    size_t folded_moves() const
+    {
+        return folded_moves_;
+    }
+
+    // Записать перемещение фигуры с клетки from на клетку to.
+    // captured - клетка побитой фигуры (-1 - без взятия), promoted - фигура стала дамкой,
+    // beat_series - номер взятия в серии. Отмененные шаги забываются.
+    void push(const int from, const int to, const int captured, const bool promoted, const int beat_series)
+    {
+        if (!current.get(from) || current.get(to))
+            throw runtime_error("history step does not match position");
+        HistoryStep step;
+        step.from = uint8_t(from);
+        step.to = uint8_t(to);
+        if (captured != -1)
+            step.captured = uint8_t(captured | (current.get(captured) << 5));
+        step.series = uint8_t(min(beat_series, 0x7F) | (promoted ? 0x80 : 0));
+
+        steps_.resize(cursor);
+        checkpoints.resize(cursor / CHECKPOINT_INTERVAL + 1);
+        steps_.push_back(step);
+        apply(current, step);
+        if (++cursor % CHECKPOINT_INTERVAL == 0)
+        {
+            checkpoints.push_back(current);
+            fold();
+        }
+    }
+
+    bool can_undo() const
+    {
+        return cursor > 0;
+    }
+
+    bool can_redo() const
+    {
+        return cursor < steps_.size();
+    }
+
+    // Отменить последний шаг
+    void undo()
+    {
+        if (!can_undo())
+            throw runtime_error("nothing to undo");
+        unapply(current, steps_[--cursor]);
+    }
+
+    // Повторить отмененный шаг
+    void redo()
+    {
+        if (!can_redo())
+            throw runtime_error("nothing to redo");
+        apply(current, steps_[cursor++]);
+    }
+
+    // Текущая позиция
+    const Position &position() const
+    {
+        return current;
+    }
+
+    // Количество сделанных (не отмененных) шагов
+    size_t size() const
+    {
+        return cursor;
+    }
+
+    // Последний сделанный шаг (size() > 0)
+    const HistoryStep &last() const
+    {
+        return steps_[cursor - 1];
+    }
+
+    // Все записанные шаги, включая отмененные (их size() первых сделаны)
+    const vector<HistoryStep> &steps() const
+    {
+        return steps_;
+    }
+
+    // Позиция после ply шагов (ply не больше steps().size())
+    Position position_at(const size_t ply) const
+    {
+        if (ply > steps_.size())
+            throw runtime_error("history has no such ply");
+        Position pos = checkpoints[ply / CHECKPOINT_INTERVAL];
+        for (size_t i = ply / CHECKPOINT_INTERVAL * CHECKPOINT_INTERVAL; i < ply; ++i)
+            apply(pos, steps_[i]);
+        return pos;
+    }
+
+    // Выполнить шаг step в позиции pos
+    static void apply(Position &pos, const HistoryStep &step)
+    {
+        const POS_T type = pos.get(step.from);
+        if (step.is_capture())
+            pos.set(step.captured_square(), 0);
+        pos.set(step.from, 0);
+        pos.set(step.to, POS_T(type + (step.promoted() ? 2 : 0)));
+    }
+
+    // Отменить шаг step в позиции pos
+    static void unapply(Position &pos, const HistoryStep &step)
+    {
+        const POS_T type = pos.get(step.to);
+        pos.set(step.to, 0);
+        pos.set(step.from, POS_T(type - (step.promoted() ? 2 : 0)));
+        if (step.is_capture())
+            pos.set(step.captured_square(), step.captured_type());
+    }
+
+  private:
+    // Складывает в начальную позицию самые старые шаги, если после них
+    // остается не меньше undo_depth ходов. Граница - сохраненная позиция,
+    // с которой начинается ход без взятия: тогда история после сложения
+    // выглядит как партия, начатая с этой позиции.
+    void fold()
+    {
+        if (!undo_depth)
+            return;
+        size_t moves = 0;
+        for (size_t i = cursor; i-- > CHECKPOINT_INTERVAL;)
+        {
+            // Шаг со взятием номер больше 1 продолжает ход
+            moves += steps_[i].beat_series() <= 1;
+            if (i % CHECKPOINT_INTERVAL || steps_[i].is_capture() || moves < undo_depth)
+                continue;
+            for (size_t j = 0; j < i; ++j)
+                folded_moves_ += steps_[j].beat_series() <= 1;
+            steps_.erase(steps_.begin(), steps_.begin() + i);
+            checkpoints.erase(checkpoints.begin(), checkpoints.begin() + i / CHECKPOINT_INTERVAL);
+            cursor -= i;
+            return;
+        }
+    }
+
+    vector<HistoryStep> steps_;
+    // Позиции после 0, CHECKPOINT_INTERVAL, 2 * CHECKPOINT_INTERVAL, ... шагов
+    vector<Position> checkpoints;
+    Position current;
+    size_t cursor = 0;
+    // Глубина отмены в ходах (0 - без ограничения) и количество сложенных ходов
+    size_t undo_depth = 0;
+    size_t folded_moves_ = 0;
+};
@@ -0,0 +1,371 @@
+#pragma once
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <nlohmann/json.hpp>
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+using json = nlohmann::json;
+using namespace std;
+
+#include "../Models/Project_path.h"
+
+// Уровни сообщений журнала (FAILURE - ошибка; имя ERROR занято макросом windows.h)
+enum class LogLevel
+{
+    TRACE,
+    INFO,
+    WARNING,
+    FAILURE
+};
+
+inline const char *log_level_name(const LogLevel level)
+{
+    switch (level)
+    {
+    case LogLevel::TRACE:
+        return "trace";
+    case LogLevel::INFO:
+        return "info";
+    case LogLevel::WARNING:
+        return "warning";
+    default:
+        return "error";
+    }
+}
+
+// Уровень по имени из настроек; неизвестное имя - INFO
+inline LogLevel log_level_from_name(const std::string &name)
+{
+    for (const LogLevel level : {LogLevel::TRACE, LogLevel::INFO, LogLevel::WARNING, LogLevel::FAILURE})
+    {
+        if (name == log_level_name(level))
+            return level;
+    }
+    return LogLevel::INFO;
+}
+
+// Журнал в файле с записью в фоновом потоке.
+// Поток игры или поиска только кладет готовую строку в кольцевой буфер
+// (очередь Вьюкова без блокировок: место в буфере занимается одной
+// атомарной операцией) и не ждет диска. Фоновый поток забирает строки
+// из буфера и пишет их в файл раз в FLUSH_INTERVAL_MS или по запросу flush().
+// Если буфер переполнен, строка отбрасывается, а в журнал потом
+// пишется, сколько строк пропало: игра не ждет журнал.
+// Все журналы дописываются на диск при выходе из программы (деструктор
+// и atexit), при аварийном завершении (сигналы SIGSEGV, SIGABRT, SIGFPE,
+// SIGILL) и при std::terminate. SIGINT и SIGTERM не перехватываются:
+// SDL превращает их в событие SDL_QUIT, и игра завершается обычным путем.
+class Logger
+{
+  public:
+    // Строк в кольцевом буфере
+    static const size_t CAPACITY = 4096;
+    // Период записи в файл
+    static const int FLUSH_INTERVAL_MS = 100;
+    // Сколько обработчик сигнала ждет, пока другой поток допишет буфер
+    static const int SIGNAL_WAIT_MS = 500;
+
+    // Журнал в файле path; truncate - очистить файл, иначе дописывать
+    Logger(const std::string &path, const bool truncate) : start(std::chrono::steady_clock::now())
+    {
+        for (size_t i = 0; i < CAPACITY; ++i)
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        file = fopen(path.c_str(), truncate ? "w" : "a");
+#ifdef _WIN32
+        fd = file ? _fileno(file) : -1;
+#else
+        fd = file ? fileno(file) : -1;
+#endif
+        register_logger(this);
+        writer = std::thread([this]() { write_loop(); });
+    }
+
+    Logger(const Logger &) = delete;
+    Logger &operator=(const Logger &) = delete;
+
+    ~Logger()
+    {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        writer.join();
+        unregister_logger(this);
+        drain();
+        if (file)
+            fclose(file);
+    }
+
+    // Настройки: минимальный уровень записываемых сообщений
+    // и формат (true - строка JSON на сообщение, false - текст)
+    void configure(const LogLevel level, const bool json_format)
+    {
+        min_level.store(level, std::memory_order_relaxed);
+        use_json.store(json_format, std::memory_order_relaxed);
+    }
+
+    bool enabled(const LogLevel level) const
+    {
+        return level >= min_level.load(std::memory_order_relaxed);
+    }
+
+    // Сообщение text уровня level с дополнительными полями fields (объект JSON).
+    // Текстовый формат - время, уровень и text (поля только в формате JSON).
+    void log(const LogLevel level, const std::string &text, const json &fields = json::object())
+    {
+        if (!enabled(level))
+            return;
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::string line;
+        if (use_json.load(std::memory_order_relaxed))
+        {
+            json record = {{"time_ms", int64_t(ms)}, {"level", log_level_name(level)}, {"message", text}};
+            record.update(fields);
+            line = record.dump();
+        }
+        else
+        {
+            line = std::to_string(int64_t(ms)) + " " + log_level_name(level) + ": " + text;
+        }
+        push(std::move(line));
+    }
+
+    // Готовая строка без времени и уровня (например, строка JSON статистики)
+    void write(std::string line)
+    {
+        push(std::move(line));
+    }
+
+    // Просит фоновый поток записать буфер сейчас, не дожидаясь периода
+    void flush()
+    {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            flush_requested = true;
+        }
+        wake.notify_one();
+    }
+
+  private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence{0};
+        std::string line;
+    };
+
+    // Кладет строку в буфер; если места нет, строка отбрасывается
+    void push(std::string line)
+    {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Slot &slot = slots[pos % CAPACITY];
+            const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const intptr_t diff = intptr_t(sequence) - intptr_t(pos);
+            if (diff == 0)
+            {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    slot.line = std::move(line);
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return;
+                }
+            }
+            else if (diff < 0)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            else
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Пишет в файл все строки из буфера. Читать буфер может только один поток:
+    // если его уже читает другой (фоновый поток или обработчик сигнала), то ничего не делает.
+    // in_signal - вызов из обработчика сигнала: строки пишутся в обход stdio
+    // (буфер stdio пуст - каждый drain заканчивается fflush). Обработчик сигнала
+    // сначала ждет до SIGNAL_WAIT_MS, пока другой поток закончит запись, чтобы
+    // не потерять строки, которые тот еще не взял. Ожидание ограничено: если
+    // сигнал пришел в самом потоке записи посреди drain, флаг уже не снимется.
+    void drain(const bool in_signal = false)
+    {
+        if (draining.test_and_set(std::memory_order_acquire))
+        {
+            if (!in_signal)
+                return;
+            // Только атомарные операции и чтение часов - без блокировок и выделения памяти
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(SIGNAL_WAIT_MS);
+            while (draining.test_and_set(std::memory_order_acquire))
+            {
+                if (std::chrono::steady_clock::now() > deadline)
+                    return;
+            }
+        }
+        bool written = false;
+        while (true)
+        {
+            Slot &slot = slots[dequeue_pos % CAPACITY];
+            if (slot.sequence.load(std::memory_order_acquire) != dequeue_pos + 1)
+                break;
+            if (in_signal)
+            {
+                write_direct(slot.line.data(), slot.line.size());
+                write_direct("\n", 1);
+            }
+            else if (file)
+            {
+                fwrite(slot.line.data(), 1, slot.line.size(), file);
+                fputc('\n', file);
+            }
+            slot.line.clear();
+            slot.sequence.store(dequeue_pos + CAPACITY, std::memory_order_release);
+            ++dequeue_pos;
+            written = true;
+        }
+        if (in_signal)
+        {
+            draining.clear(std::memory_order_release);
+            return;
+        }
+        const size_t lost = dropped.exchange(0, std::memory_order_relaxed);
+        if (lost && file)
+            fprintf(file, "%zu log lines dropped: buffer is full\n", lost);
+        if ((written || lost) && file)
+            fflush(file);
+        draining.clear(std::memory_order_release);
+    }
+
+    void write_loop()
+    {
+        std::unique_lock<std::mutex> lock(wake_mutex);
+        while (!stopping)
+        {
+            wake.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL_MS),
+                          [this]() { return stopping || flush_requested; });
+            flush_requested = false;
+            lock.unlock();
+            drain();
+            lock.lock();
+        }
+    }
+
+    // Все открытые журналы - для записи при аварийном завершении
+    static const int MAX_LOGGERS = 8;
+
+    static std::atomic<Logger *> *registry()
+    {
+        static std::atomic<Logger *> loggers[MAX_LOGGERS];
+        return loggers;
+    }
+
+    static void flush_all(const bool in_signal)
+    {
+        for (int i = 0; i < MAX_LOGGERS; ++i)
+        {
+            if (Logger *logger = registry()[i].load())
+                logger->drain(in_signal);
+        }
+    }
+
+    static void flush_all()
+    {
+        flush_all(false);
+    }
+
+    // Обработчик сигнала аварийного завершения: дописать журналы
+    // и завершиться так же, как без обработчика
+    static void on_signal(const int sig)
+    {
+        flush_all(true);
+        signal(sig, SIG_DFL);
+        raise(sig);
+    }
+
+    // Запись в файл системным вызовом без буфера stdio: в отличие от fwrite,
+    // ее можно делать в обработчике сигнала
+    void write_direct(const char *data, size_t size)
+    {
+        while (fd >= 0 && size > 0)
+        {
+#ifdef _WIN32
+            const int n = _write(fd, data, unsigned(size));
+#else
+            const ssize_t n = ::write(fd, data, size);
+#endif
+            if (n <= 0)
+                return;
+            data += n;
+            size -= size_t(n);
+        }
+    }
+
+    static void register_logger(Logger *logger)
+    {
+        static std::once_flag handlers;
+        std::call_once(handlers, []() {
+            for (const int sig : {SIGSEGV, SIGABRT, SIGFPE, SIGILL})
+                signal(sig, on_signal);
+            static const std::terminate_handler previous = std::set_terminate([]() {
+                flush_all();
+                if (previous)
+                    previous();
+                std::abort();
+            });
+            atexit(flush_all);
+        });
+        for (int i = 0; i < MAX_LOGGERS; ++i)
+        {
+            Logger *expected = nullptr;
+            if (registry()[i].compare_exchange_strong(expected, logger))
+                return;
+        }
+    }
+
+    static void unregister_logger(Logger *logger)
+    {
+        for (int i = 0; i < MAX_LOGGERS; ++i)
+        {
+            Logger *expected = logger;
+            registry()[i].compare_exchange_strong(expected, nullptr);
+        }
+    }
+
+    const std::chrono::steady_clock::time_point start;
+    std::unique_ptr<Slot[]> slots{new Slot[CAPACITY]};
+    std::atomic<size_t> enqueue_pos{0};
+    size_t dequeue_pos = 0;
+    std::atomic<size_t> dropped{0};
+    std::atomic_flag draining = ATOMIC_FLAG_INIT;
+    std::atomic<LogLevel> min_level{LogLevel::INFO};
+    std::atomic<bool> use_json{false};
+    FILE *file = nullptr;
+    // Дескриптор file для записи из обработчика сигнала
+    int fd = -1;
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    bool flush_requested = false;
+    std::thread writer;
+};
+
+// Общий журнал игры (log.txt). Файл очищается при первом обращении.
+inline Logger &game_log()
+{
+    static Logger logger(project_path + "log.txt", true);
+    return logger;
+}
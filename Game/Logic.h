@@ -1,15 +1,100 @@
 #pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
 #include <random>
+#include <string>
+#include <thread>
 #include <vector>
 #include <queue>
 
 #include "../Models/Move.h"
-#include "Board.h"
+#include "../Models/Position.h"
 #include "Config.h"
+#include "Book.h"
+#include "Logger.h"
+#include "Score.h"
+#include "SearchStats.h"
+#include "Tablebase.h"
+#include "TTable.h"
 
-const int INF = 1e9;
+using namespace std;
 
-typedef vector<vector<POS_T>> Matrix;
+// Предельная глубина при поиске с ограничением по времени
+const int MAX_DEPTH = 100;
+// Предельное количество ходов форсированного поиска взятий за горизонтом
+const int MAX_QUIESCENCE_PLY = 32;
+// Оценка выигрыша по эндшпильной таблице: меньше, чем INF (соперник
+// без фигур), и уменьшается с расстоянием до конца партии
+const double TB_WIN = INF / 2;
+// Шаг оценки проигрыша по таблице: проигрыш оценивается больше,
+// чем -1 (нет ходов), и меньше любой обычной оценки, чем дальше - тем больше
+const double TB_LOSS_STEP = 1e-3;
+// Предельная глубина узла поиска с учетом форсированного поиска
+// (вспомогательные потоки ищут на один ход глубже основного)
+const int MAX_PLY = MAX_DEPTH + MAX_QUIESCENCE_PLY + 2;
+// Наибольшее расстояние до конца партии от корня поиска в оценке по таблице
+const int TB_MAX_PLY_DISTANCE = MAX_PLY + TB_MAX_DISTANCE;
+// Начальная ширина окна стремления (aspiration window): окно
+// от оценки предыдущей итерации, деленной на ширину, до умноженной на нее.
+// Оценка - отношение сил сторон, поэтому окно мультипликативное.
+const double ASPIRATION_WIDTH = 1.05;
+// Ширина, после которой окно стремления раскрывается полностью
+const double MAX_ASPIRATION_WIDTH = 16;
+
+// Упакованный полный ход для поиска.
+// В отличие от Turn не хранит ни перемещений, ни доски,
+// а только то, что нужно, чтобы сделать и отменить ход.
+struct PackedTurn
+{
+    // Маска клеток побитых фигур
+    uint32_t beaten = 0;
+    // Начальная и конечная клетки хода
+    int8_t from = -1, to = -1;
+    // Фигура стала дамкой во время хода
+    bool promotion = false;
+
+    // Делает ход игрока color в позиции pos
+    void apply(Position &pos, const bool color) const
+    {
+        uint32_t &own = color ? pos.black : pos.white;
+        uint32_t &enemy = color ? pos.white : pos.black;
+        const uint32_t from_bit = 1u << from;
+        const uint32_t to_bit = 1u << to;
+        const bool is_king = (pos.kings & from_bit) != 0;
+
+        // Убрать побитые фигуры и переставить фигуру. Дамка
+        // может закончить взятие на той же клетке, с которой начала.
+        enemy &= ~beaten;
+        own = (own & ~from_bit) | to_bit;
+        pos.kings &= ~(beaten | from_bit);
+        if (is_king || promotion)
+            pos.kings |= to_bit;
+    }
+};
+
+// Наибольшее количество ходов в одной позиции
+const int MAX_TURNS = 256;
+
+// Список ходов фиксированной емкости для одного уровня поиска.
+// Для каждого хода хранится ключ, определяющий порядок просмотра.
+struct TurnList
+{
+    PackedTurn turns[MAX_TURNS];
+    int64_t keys[MAX_TURNS];
+    int size = 0;
+
+    // Добавить ход в список (лишние ходы отбрасываются,
+    // в реальных позициях их бывает намного меньше MAX_TURNS)
+    void add(const PackedTurn &turn)
+    {
+        if (size < MAX_TURNS)
+            turns[size++] = turn;
+    }
+};
 
 // Структура, описывающая один полный ход,
 // который может быть простым ходом без взятия,
@@ -22,7 +107,7 @@ struct Turn
     vector<move_pos> series;
 
     // Финальное состояние доски после завершения хода 
-    Matrix final_mtx;
+    Position final_pos;
 
     // Возврвщает первое перемещение
     const move_pos& first() const
@@ -35,173 +120,925 @@ struct Turn
     {
         return series.back();
     }
+
+    // Возвращает маску клеток, на которых были побиты фигуры
+    uint32_t beaten() const
+    {
+        uint32_t res = 0;
+        for (const auto &move : series)
+        {
+            if (move.xb != -1)
+                res |= 1u << square(move.xb, move.yb);
+        }
+        return res;
+    }
+
+    // Возвращает упакованный ход, сделанный из позиции pos
+    PackedTurn pack(const Position &pos) const
+    {
+        PackedTurn res;
+        res.beaten = beaten();
+        res.from = int8_t(square(first().x, first().y));
+        res.to = int8_t(square(last().x2, last().y2));
+        res.promotion = !(pos.kings & (1u << res.from)) && (final_pos.kings & (1u << res.to));
+        return res;
+    }
 };
 
 class Logic
 {
   public:
-    Logic(Board *board, Config *config) : board(board), config(config)
+    Logic(Config *config) : config(config)
     {
         rand_eng = std::default_random_engine (
             !((*config)("Bot", "NoRandom")) ? unsigned(time(0)) : 0);
         scoring_mode = (*config)("Bot", "BotScoringType");
+        with_potential = scoring_mode == "NumberAndPotential";
+        specialized = (*config)("Bot", "SpecializedSearch");
         optimization = (*config)("Bot", "Optimization");
+        use_pvs = optimization != "O0";
+        selective = optimization == "O2";
+        lmr_min_depth = (*config)("Bot", "LMRMinDepth");
+        lmr_move_count = (*config)("Bot", "LMRMoveCount");
+        lmr_reduction = max(1, int((*config)("Bot", "LMRReduction")));
+        futility_margin = (*config)("Bot", "FutilityMargin");
+        razor_margin = (*config)("Bot", "RazorMargin");
+        quiescence_max_ply = min(MAX_QUIESCENCE_PLY, int((*config)("Bot", "QuiescenceMaxPly")));
+        stand_pat = (*config)("Bot", "QuiescenceStandPat");
+        const string tb_path = (*config)("Bot", "TablebasePath");
+        if (!tb_path.empty())
+        {
+            // Поврежденные таблицы не мешают игре: бот играет без них
+            try
+            {
+                tablebase = make_shared<const Tablebase>(project_path + tb_path);
+            }
+            catch (const exception &e)
+            {
+                game_log().log(LogLevel::WARNING, "Can't load tablebases: " + string(e.what()),
+                               {{"tablebase_path", tb_path}});
+            }
+            if (tablebase && tablebase->empty())
+                tablebase.reset();
+        }
+        const string book_path = (*config)("Bot", "OpeningBook");
+        if (!book_path.empty())
+        {
+            // С поврежденной книгой бот играет без нее
+            try
+            {
+                book = make_shared<const Book>(project_path + book_path);
+            }
+            catch (const exception &e)
+            {
+                game_log().log(LogLevel::WARNING, "Can't load opening book: " + string(e.what()),
+                               {{"book_path", book_path}});
+            }
+            if (book && book->empty())
+                book.reset();
+        }
+        tt = make_shared<TTable>((*config)("Bot", "TTSizeMB"));
+        time_limit_ms = (*config)("Bot", "BotTimeLimitMS");
+        threads = max(1, int((*config)("Bot", "Threads")));
+        clear_order_stats();
     }
 
-    // Находит лучший ход для бота заданного цвета
-    vector<move_pos> find_best_turns(const bool color)
+    // Находит лучший ход для бота заданного цвета в позиции pos
+    vector<move_pos> find_best_turns(const bool color, const Position &pos)
     {        
+        stats = SearchStats();
         // Получение списка всех доступных ходов
-        vector<Turn> res_turns = find_series(color, board->get_board());
-        
+        vector<Turn> res_turns = find_series(color, pos);
+        if (res_turns.empty())
+            return {};
+        // Если позиция есть в дебютной книге, то ход берется из нее без поиска
+        if (const Turn *turn = book_turn(color, pos, res_turns))
+            return turn->series;
+        Max_depth = min(Max_depth, MAX_DEPTH);
+        // Позиция, в которой поиск делает и отменяет ходы
+        search_pos = pos;
+        search_hash = hash_position(pos);
+        search_eval = Eval::of(pos);
+        // Ядро поиска выбирается один раз, вспомогательные потоки получают его с копией
+        kernel = specialized ? select_kernel(color) : &Logic::find_best_turns_rec<DynamicOptions, false>;
+
+        // Случайный порядок ходов в корне, чтобы бот не играл
+        // одинаково при равных оценках. Глубже порядок задается
+        // эвристиками упорядочивания ходов.
+        shuffle(res_turns.begin(), res_turns.end(), rand_eng);
+        // Статистика отсечений предыдущего хода не используется
+        clear_order_stats();
+
+        // Время окончания поиска, если он ограничен по времени
+        const auto start = chrono::steady_clock::now();
+        deadline = start + chrono::milliseconds(time_limit_ms);
+        next_time_check = nodes;
+        const uint64_t nodes_before = nodes, tb_hits_before = tb_hits;
+
+        // Параллельный поиск (Lazy SMP): вспомогательные потоки ищут
+        // в той же позиции со своим порядком ходов и глубиной и заполняют
+        // общую таблицу транспозиций, а основной поток использует их оценки.
+        // Ход выбирает только основной поток.
+        vector<Logic> helper_logics(threads - 1, *this);
+        atomic<bool> helpers_stop(false);
+        vector<thread> helpers;
+        for (int i = 0; i < threads - 1; ++i)
+        {
+            helpers.emplace_back([&, i, root_turns = res_turns]() mutable {
+                helper_logics[i].helper_search(root_turns, color, &helpers_stop, i + 1);
+            });
+        }
+
+        // Без ограничения по времени поиск идет на глубину Max_depth,
+        // иначе используется итеративное углубление
+        Turn best_turn;
+        if (time_limit_ms)
+            best_turn = iterative_search(res_turns, color);
+        else
+        {
+            best_turn = find_best_turn(res_turns, color, &stats.score);
+            stats.iterations.push_back({Max_depth + 1, nodes - nodes_before, elapsed_ms(start), false});
+        }
+        stats.nodes = nodes - nodes_before;
+        stats.tb_hits = tb_hits - tb_hits_before;
+        stats.ms = elapsed_ms(start);
+
+        helpers_stop = true;
+        for (auto &th : helpers)
+            th.join();
+
+        // Вернуть список перемещений для лучшего хода
+        return best_turn.series;
+    }
+
+    // Обдумывание на время хода соперника (pondering): ищет ответы бота
+    // на все ходы соперника color в позиции pos так же, как find_best_turns,
+    // пока не придет сигнал stop. Первым просматривается ожидаемый ход соперника -
+    // лучший ход по таблице транспозиций после прошлого поиска бота.
+    // Ответ на каждый полностью просчитанный ход передается в on_reply
+    // вместе с позицией после хода соперника. Прерванный поиск тоже полезен:
+    // его оценки остаются в общей таблице транспозиций.
+    void ponder(const bool color, const Position &pos, const atomic<bool> *stop,
+                const function<void(const Position &, vector<move_pos>)> &on_reply)
+    {
+        stop_signal = stop;
+        TurnList list;
+        generate_turns(color, pos, list);
+        TTEntry entry;
+        if (tt->probe(tt_key(hash_position(pos), color, !color), entry))
+        {
+            for (int i = 0; i < list.size; ++i)
+            {
+                const PackedTurn &turn = list.turns[i];
+                if (turn.from == entry.from && turn.to == entry.to && turn.beaten == entry.beaten)
+                {
+                    swap(list.turns[i], list.turns[0]);
+                    break;
+                }
+            }
+        }
+        // Каждый ответ ищется с тем же состоянием ГПСЧ, что и у основного
+        // поиска, чтобы бот выбирал тот же ход, что и без обдумывания
+        const default_random_engine start_eng = rand_eng;
+        for (int i = 0; i < list.size && !stop->load(); ++i)
+        {
+            Position next = pos;
+            list.turns[i].apply(next, color);
+            rand_eng = start_eng;
+            vector<move_pos> reply = find_best_turns(!color, next);
+            if (!stop->load())
+                on_reply(next, std::move(reply));
+        }
+    }
+
+    // Задает состояние ГПСЧ, от которого зависит выбор из равных ходов
+    void seed(const unsigned int value)
+    {
+        rand_eng.seed(value);
+    }
+
+    // Состояние ГПСЧ. Обдуманный ответ переносит в основной бот состояние
+    // после своего поиска, чтобы дальше партия шла так же, как без обдумывания.
+    const default_random_engine &random_engine() const
+    {
+        return rand_eng;
+    }
+
+    void set_random_engine(const default_random_engine &eng)
+    {
+        rand_eng = eng;
+    }
+
+    // Ограничение времени поиска хода (0 - поиск на глубину Max_depth),
+    // по умолчанию BotTimeLimitMS из настроек
+    void set_time_limit(const unsigned int ms)
+    {
+        time_limit_ms = ms;
+    }
+
+    // Статистика последнего поиска в виде JSON
+    json stats_json() const
+    {
+        return stats.to_json(!tt->empty());
+    }
+
+    // Статическая оценка позиции pos для бота цвета bot_color в режиме
+    // оценки из настроек (то же, что дает поиск в листе дерева)
+    double static_score(const Position &pos, const bool bot_color) const
+    {
+        const Eval eval = Eval::of(pos);
+        return eval.score(pos, bot_color, with_potential);
+    }
+
+
+private:
+    // Выбирает ход из дебютной книги среди ходов res_turns случайно с учетом весов.
+    // Возвращает nullptr, если книги нет или позиции в ней нет.
+    const Turn *book_turn(const bool color, const Position &pos, const vector<Turn> &res_turns)
+    {
+        if (!book)
+            return nullptr;
+        const auto range = book->find(book_key(pos, color));
+        // Ходы книги, которые есть среди допустимых (ключ мог совпасть случайно)
+        vector<pair<const Turn *, uint32_t>> candidates;
+        uint32_t total = 0;
+        for (const BookMove *move = range.first; move != range.second; ++move)
+        {
+            for (const auto &turn : res_turns)
+            {
+                const PackedTurn packed = turn.pack(pos);
+                if (move->weight && packed.from == move->from && packed.to == move->to && packed.beaten == move->beaten)
+                {
+                    candidates.push_back({&turn, move->weight});
+                    total += move->weight;
+                    break;
+                }
+            }
+        }
+        if (!total)
+            return nullptr;
+        uint32_t pick = uniform_int_distribution<uint32_t>(1, total)(rand_eng);
+        for (const auto &candidate : candidates)
+        {
+            if (pick <= candidate.second)
+                return candidate.first;
+            pick -= candidate.second;
+        }
+        return nullptr;
+    }
+
+    // Поиск с итеративным углублением: поиск повторяется
+    // с увеличением глубины, пока не закончится отведенное время.
+    // Результат прерванной итерации отбрасывается.
+    // С PVS каждая итерация ищет в окне стремления вокруг оценки предыдущей,
+    // а если оценка вышла за окно, то поиск повторяется с более широким окном.
+    Turn iterative_search(vector<Turn> &res_turns, const bool color)
+    {
+        const int level_depth = Max_depth;
+        Turn best_turn = res_turns.front();
+        double prev_score = -1;
+        for (Max_depth = 0; Max_depth <= MAX_DEPTH && res_turns.size() > 1; ++Max_depth)
+        {
+            const auto start = chrono::steady_clock::now();
+            const uint64_t nodes_before = nodes;
+            // Самая первая итерация не прерывается, чтобы ход был найден всегда
+            use_deadline = Max_depth > 0;
+            double width = ASPIRATION_WIDTH;
+            double alpha = -1, beta = INF;
+            if (use_pvs && Max_depth > 0 && prev_score > 0 && prev_score < INF)
+            {
+                alpha = prev_score / width;
+                beta = prev_score * width;
+            }
+            double max_score;
+            Turn turn;
+            while (true)
+            {
+                turn = find_best_turn(res_turns, color, &max_score, alpha, beta);
+                if (stopped || (max_score >= alpha && max_score <= beta))
+                    break;
+                width *= width;
+                if (max_score < alpha)
+                    alpha = width > MAX_ASPIRATION_WIDTH ? -1 : prev_score / width;
+                else
+                    beta = width > MAX_ASPIRATION_WIDTH ? INF : prev_score * width;
+            }
+            stats.iterations.push_back({Max_depth + 1, nodes - nodes_before, elapsed_ms(start), stopped});
+            if (stopped)
+                break;
+            best_turn = turn;
+            prev_score = stats.score = max_score;
+            // Лучший ход предыдущей итерации просматривается первым
+            swap(*find_if(res_turns.begin(), res_turns.end(),
+                          [&](const Turn &t) { return t.series == turn.series; }),
+                 res_turns.front());
+            // Найден выигрыш, углубляться дальше нет смысла
+            if (max_score >= INF)
+                break;
+        }
+        use_deadline = stopped = false;
+        Max_depth = level_depth;
+        return best_turn;
+    }
+
+    // Поиск во вспомогательном потоке номер index.
+    // Итеративное углубление со своим случайным порядком ходов в корне;
+    // нечетные потоки ищут на одну глубину дальше основного.
+    // Поиск прекращается, когда основной поток выставит флаг stop.
+    void helper_search(vector<Turn> &res_turns, const bool color, const atomic<bool> *stop, const int index)
+    {
+        stop_signal = stop;
+        use_deadline = time_limit_ms != 0;
+        rand_eng.seed(index);
+        shuffle(res_turns.begin(), res_turns.end(), rand_eng);
+        const int max_depth = time_limit_ms ? MAX_DEPTH : Max_depth + index % 2;
+        for (Max_depth = index % 2; Max_depth <= max_depth && !stopped; ++Max_depth)
+            find_best_turn(res_turns, color);
+    }
+
+    // Выбирает лучший из ходов res_turns поиском на глубину Max_depth.
+    // Если задан max_score, то в него записывается оценка лучшего хода.
+    // Оценка ищется в окне [alpha, beta]: если она вышла за окно,
+    // то это только граница, и поиск нужно повторить с более широким окном.
+    Turn find_best_turn(const vector<Turn> &res_turns, const bool color, double *max_score_out = nullptr,
+                        const double alpha = -1, const double beta = INF)
+    {
         // Выбор лучшего хода используя алгоритм Минимакс
         // с альфа-бета отсечением
         Turn best_turn;
         double max_score = -1;
         for (const auto& turn : res_turns)
         {            
-            // Найти оценку для каждого из возможных ходов
-            double score = find_best_turns_rec(turn, !color, 0);
-            if (score > max_score)
+            // Найти оценку для каждого из возможных ходов.
+            // Ходы, которые не лучше уже найденного, отсекаются
+            const PackedTurn packed = turn.pack(search_pos);
+            stats.max_capture_chain = max(stats.max_capture_chain, popcount(packed.beaten));
+            Undo undo;
+            make_turn(packed, color, undo);
+            const double bound = max(max_score, alpha);
+            double score;
+            if (use_pvs && !best_turn.series.empty())
+            {
+                // Проверка нулевым окном, что ход лучше найденного
+                score = search(!color, 0, Max_depth, bound, bound);
+                if (score > bound && score <= beta)
+                    score = search(!color, 0, Max_depth, bound, beta);
+            }
+            else
+                score = search(!color, 0, Max_depth, bound, beta);
+            unmake_turn(packed, color, undo);
+            if (stopped)
+                break;
+            if (score > max_score || best_turn.series.empty())
             {
                 // выбрать лучший ход
                 max_score = score;
                 best_turn = turn;
             }            
+            // Оценка выше окна, остальные ходы не нужны
+            if (max_score > beta)
+                break;
         }
-
-        // Вернуть список перемещений для лучшего хлда
-        return best_turn.series;
+        if (max_score_out)
+            *max_score_out = max_score;
+        return best_turn;
     }
-        
 
-private:
-    // Делает ход turn на доске mtx.
-    // Возвращает новую доску, на которой сделан ход.
-    vector<vector<POS_T>> make_turn(vector<vector<POS_T>> mtx, move_pos turn) const
+    // Добавляет перемещение move к ходу turn
+    // и меняет финальную позицию хода.
+    void make_turn(Turn &turn, const move_pos &move) const
     {
+        Position &pos = turn.final_pos;
+        const uint32_t from = 1u << square(move.x, move.y);
+        const uint32_t to = 1u << square(move.x2, move.y2);
+
         // Если ход со взятием, то убрать побитую фигуру
-        if (turn.xb != -1)
-            mtx[turn.xb][turn.yb] = 0;
-        
-        // Если фигура дошла до противоположного края, то
-        // сделать ее дамкой
-        if ((mtx[turn.x][turn.y] == 1 && turn.x2 == 0) || (mtx[turn.x][turn.y] == 2 && turn.x2 == 7))
-            mtx[turn.x][turn.y] += 2;
+        if (move.xb != -1)
+        {
+            const uint32_t beaten = ~(1u << square(move.xb, move.yb));
+            pos.white &= beaten;
+            pos.black &= beaten;
+            pos.kings &= beaten;
+        }
+
+        // Переставить фигуру с начального поля на конечное
+        const bool is_black = (pos.black & from) != 0;
+        if (is_black)
+            pos.black ^= from | to;
+        else
+            pos.white ^= from | to;
 
-        // Поставить фигуру на конечное поле
-        mtx[turn.x2][turn.y2] = mtx[turn.x][turn.y];
-        // Убрать фигуру с начального поля
-        mtx[turn.x][turn.y] = 0;
+        if (pos.kings & from)
+            pos.kings ^= from | to;
+        else if (to & (is_black ? BOTTOM_ROW : TOP_ROW))
+            pos.kings |= to; // фигура дошла до противоположного края и стала дамкой
 
-        return mtx;
+        turn.series.push_back(move);
     }
 
-    // Оценка позиции для бота.
-    // Если first_bot_color == true, то бот черного цвета (очень 
-    // не очевидное название параметра).
-    double calc_score(const vector<vector<POS_T>> &mtx, const bool first_bot_color) const
+    // Слагаемые оценки позиции: количество пешек и дамок каждого цвета
+    // и номера таблицы сил пешек с продвижением (men_table_index).
+    // Пересчитываются при каждом ходе поиска, поэтому оценка листа
+    // не перебирает фигуры.
+    struct Eval
     {
-        // color - who is max player
+        int w_men = 0, w_kings = 0, b_men = 0, b_kings = 0;
+        int w_rows = 0, b_rows = 0;
 
-        // Счетчики пешек и дамок для двух цветов.
-        double w = 0, wq = 0, b = 0, bq = 0;
-        
-        // Подсчет фигур
-        for (POS_T i = 0; i < 8; ++i)
+        static Eval of(const Position &pos)
         {
-            for (POS_T j = 0; j < 8; ++j)
+            Eval res;
+            for (uint32_t bb = pos.white | pos.black; bb; bb &= bb - 1)
             {
-                w += (mtx[i][j] == 1); // белые пешки
-                wq += (mtx[i][j] == 3); // белые дамки 
-                b += (mtx[i][j] == 2); // черные пешки
-                bq += (mtx[i][j] == 4); // черные дамки
+                const int sq = lowest_bit(bb);
+                res.add(pos.get(sq), sq, 1);
+            }
+            return res;
+        }
 
-                if (scoring_mode == "NumberAndPotential")
-                {
-                    w += 0.05 * (mtx[i][j] == 1) * (7 - i);
-                    b += 0.05 * (mtx[i][j] == 2) * (i);
-                }
+        // Добавляет (sign = 1) или убирает (sign = -1) фигуру type (1 - 4, как в Board) на клетке sq
+        void add(const int type, const int sq, const int sign)
+        {
+            switch (type)
+            {
+            case 1:
+                w_men += sign;
+                w_rows += sign * men_row_weight(sq / 4, true);
+                break;
+            case 2:
+                b_men += sign;
+                b_rows += sign * men_row_weight(sq / 4, false);
+                break;
+            case 3:
+                w_kings += sign;
+                break;
+            case 4:
+                b_kings += sign;
+                break;
             }
         }
 
-        // Если бот белого цвета, то поменять местами.
-        if (!first_bot_color)
+        // Оценка позиции pos (с этими слагаемыми) для бота, как в score_position
+        double score(const Position &pos, const bool first_bot_color, const bool potential) const
         {
-            swap(b, w);
-            swap(bq, wq);
+            double w = w_men, b = b_men;
+            if (potential)
+            {
+                w = men_potential(pos.white & ~pos.kings, w_rows, true);
+                b = men_potential(pos.black & ~pos.kings, b_rows, false);
+            }
+            return score_position(w, w_kings, b, b_kings, first_bot_color, potential);
         }
+    };
 
-        // Если кол-во белых равно нулю, то черные выиграли, 
-        // оценка максимальная.
-        if (w + wq == 0)
-            return INF;
+    // Данные для отмены хода в позиции поиска
+    struct Undo
+    {
+        uint32_t kings;
+        uint64_t hash;
+        Eval eval;
+    };
 
-        // Если кол-во черных равно нулю, то черные проиграли, 
-        // оценка минимальная.
-        if (b + bq == 0)
-            return 0;
-        
-        int q_coef = 4; // усиливающий коэффициент для дамки
-        if (scoring_mode == "NumberAndPotential")
+    // Делает ход turn игрока color в позиции поиска search_pos
+    // и пересчитывает ее хэш и слагаемые оценки. Данные для отмены сохраняются в undo.
+    void make_turn(const PackedTurn &turn, const bool color, Undo &undo)
+    {
+        undo = {search_pos.kings, search_hash, search_eval};
+
+        // Убрать фигуру с начальной клетки и побитые фигуры
+        const int type = search_pos.get(turn.from);
+        search_hash ^= zobrist().pieces[type][turn.from];
+        search_eval.add(type, turn.from, -1);
+        for (uint32_t bb = turn.beaten; bb; bb &= bb - 1)
         {
-            q_coef = 5; // при этой настройке дамка считается сильнее
+            const int sq = lowest_bit(bb);
+            const int beaten_type = search_pos.get(sq);
+            search_hash ^= zobrist().pieces[beaten_type][sq];
+            search_eval.add(beaten_type, sq, -1);
         }
-        // Получить оценку в зависимости от соотношения кол-ва фигур
-        return (b + bq * q_coef) / (w + wq * q_coef);
+
+        turn.apply(search_pos, color);
+        const int new_type = search_pos.get(turn.to);
+        search_hash ^= zobrist().pieces[new_type][turn.to];
+        search_eval.add(new_type, turn.to, 1);
     }
 
+    // Отменяет ход turn игрока color, сделанный make_turn
+    void unmake_turn(const PackedTurn &turn, const bool color, const Undo &undo)
+    {
+        uint32_t &own = color ? search_pos.black : search_pos.white;
+        uint32_t &enemy = color ? search_pos.white : search_pos.black;
+        own = (own & ~(1u << turn.to)) | (1u << turn.from);
+        enemy |= turn.beaten;
+        search_pos.kings = undo.kings;
+        search_hash = undo.hash;
+        search_eval = undo.eval;
+    }
 
-    // Алгоритм Минимакс с альфа-бета отсечением
-    double find_best_turns_rec(Turn turn, bool color, int depth, double alpha = -1, double beta = INF)
+    // Оценка позиции поиска для бота.
+    // Если first_bot_color == true, то бот черного цвета (очень 
+    // не очевидное название параметра).
+    // potential - учитывать продвижение пешек (режим "NumberAndPotential").
+    // Функция встраивается в ядро поиска, и в специализированном ядре
+    // оба параметра - константы, поэтому проверки убираются компилятором.
+    double calc_score(const bool first_bot_color, const bool potential) const
     {
-        // Если достигнута максимальная глубина, то посчитать и вернуть оценку
-        if (depth == Max_depth)
-            return calc_score(turn.final_mtx, depth % 2 == color);
+        return search_eval.score(search_pos, first_bot_color, potential);
+    }
 
 
-        // Получение списка всех доступных ходов
-        vector<Turn> res_turns = find_series(color, turn.final_mtx);
+    // Настройки поиска, известные при компиляции (специализированное ядро):
+    // режим оценки, цвет бота, уровень оптимизации (0 - O0, 1 - O1, 2 - O2),
+    // оценка без взятия и наличие эндшпильных таблиц
+    template <bool Potential, bool BotColor, int Level, bool StandPat, bool Tablebase>
+    struct StaticOptions
+    {
+        static constexpr bool specialized = true;
+        static constexpr bool potential = Potential, bot_color = BotColor;
+        static constexpr bool use_pvs = Level >= 1, selective = Level >= 2;
+        static constexpr bool stand_pat = StandPat, tablebase = Tablebase;
+    };
+
+    // Общее ядро: настройки берутся из полей во время поиска
+    struct DynamicOptions
+    {
+        static constexpr bool specialized = false;
+        static constexpr bool potential = false, bot_color = false;
+        static constexpr bool use_pvs = false, selective = false;
+        static constexpr bool stand_pat = false, tablebase = false;
+    };
+
+    // Ядро поиска (см. find_best_turns_rec)
+    using Kernel = double (Logic::*)(bool color, int depth, int horizon, double alpha, double beta);
+
+    // Выбирает ядро поиска для бота цвета bot_color один раз на поиск:
+    // каждая настройка по очереди становится параметром шаблона Flags
+    // (режим оценки, цвет бота, оценка без взятия, эндшпильные таблицы),
+    // затем по уровню оптимизации выбирается StaticOptions.
+    // В корне ходит соперник бота, поэтому ядро начинается с цвета !bot_color.
+    template <bool... Flags> Kernel select_kernel(const bool bot_color) const
+    {
+        constexpr size_t n = sizeof...(Flags);
+        if constexpr (n < 4)
+        {
+            const bool flags[] = {with_potential, bot_color, stand_pat, tablebase != nullptr};
+            return flags[n] ? select_kernel<Flags..., true>(bot_color) : select_kernel<Flags..., false>(bot_color);
+        }
+        else
+        {
+            constexpr bool flags[] = {Flags...};
+            if (selective)
+                return &Logic::find_best_turns_rec<StaticOptions<flags[0], flags[1], 2, flags[2], flags[3]>, !flags[1]>;
+            if (use_pvs)
+                return &Logic::find_best_turns_rec<StaticOptions<flags[0], flags[1], 1, flags[2], flags[3]>, !flags[1]>;
+            return &Logic::find_best_turns_rec<StaticOptions<flags[0], flags[1], 0, flags[2], flags[3]>, !flags[1]>;
+        }
+    }
+
+    // Поиск из позиции поиска, в которой ходит игрок color, на глубине depth,
+    // ядром, выбранным в начале поиска в find_best_turns.
+    double search(const bool color, const int depth, const int horizon, const double alpha, const double beta)
+    {
+        return (this->*kernel)(color, depth, horizon, alpha, beta);
+    }
 
-        if (depth % 2)
+    // Алгоритм Минимакс с альфа-бета отсечением.
+    // Ходы делаются и отменяются в позиции search_pos,
+    // списки ходов хранятся в заранее выделенных буферах ply_turns.
+    // Окно [alpha, beta] замкнутое: оценка на границе окна точная,
+    // оценка за границей - только граница. Поэтому окно нулевой ширины
+    // [bound, bound] отвечает на вопрос, больше или меньше оценка, чем bound.
+    // horizon - глубина, на которой позиция оценивается; обычно это Max_depth,
+    // а в режиме O2 неперспективные ветви просматриваются с меньшим горизонтом.
+    // За горизонтом поиск продолжается только по взятиям (форсированный поиск),
+    // пока позиция не станет спокойной, чтобы оценка не считалась посреди размена.
+    //
+    // Ядро поиска - шаблон. В специализированном ядре настройки поиска (Options,
+    // см. StaticOptions) и цвет стороны, которая ходит (Color), известны при
+    // компиляции: ядро выбирается один раз на поиск в select_kernel, рекурсия
+    // вызывает ядро другого цвета напрямую, и в узлах нет проверок настроек и цветов.
+    // В общем ядре (DynamicOptions) они берутся из параметра color и полей во время поиска.
+    template <class Options, bool Color>
+    double find_best_turns_rec(bool color, int depth, int horizon, double alpha, double beta)
+    {
+        constexpr bool Specialized = Options::specialized;
+        if (Specialized)
+            color = Color;
+        // Цвет бота, режим оценки и тип узла: максимизации для бота, минимизации - для человека
+        const bool bot_color = Specialized ? Options::bot_color : depth % 2 == color;
+        const bool potential = Specialized ? Options::potential : with_potential;
+        const bool is_max = Specialized ? Color == Options::bot_color : depth % 2;
+        // Настройки поиска
+        const bool use_pvs = Specialized ? Options::use_pvs : this->use_pvs;
+        const bool selective = Specialized ? Options::selective : this->selective;
+        const bool stand_pat = Specialized ? Options::stand_pat : this->stand_pat;
+        const bool use_tablebase = Specialized ? Options::tablebase : tablebase != nullptr;
+        // Ядро для следующего хода: в специализированном ходит другой цвет
+        constexpr bool NextColor = Specialized ? !Color : Color;
+        ++nodes;
+        // Если фигур мало, то результат известен из эндшпильной таблицы
+        if (use_tablebase && popcount(search_pos.white | search_pos.black) <= tablebase->max_pieces())
         {
-            // Максимизация для бота
-            double score = -1;
-            for (const auto& next_turn : res_turns)
+            const int value = tablebase->probe(search_pos, color);
+            if (value >= 0)
             {
-                score = max(score, find_best_turns_rec(next_turn, !color, depth + 1, alpha, beta));
-                // альфа-бета отсечение
-                if (score > beta)
-                    break;
+                ++tb_hits;
+                return tb_score(value, depth, color == bot_color);
+            }
+        }
+        // Если достигнута максимальная глубина и взятий нет,
+        // то посчитать и вернуть оценку
+        if (depth >= horizon && (depth - horizon >= quiescence_max_ply || !find_beaters(color, search_pos)))
+        {
+            ++stats.evals;
+            return calc_score(bot_color, potential);
+        }
+
+        // Проверка, не закончилось ли время на ход
+        if (stopped || time_is_over())
+            return 0;
+
+        // Поиск позиции в таблице транспозиций.
+        // Оценка подходит, если она получена не меньшей глубиной
+        // и дает такой же ответ в текущем окне: окно замкнутое,
+        // поэтому граница подходит, только если она строго за окном.
+        const int rest_depth = horizon - depth;
+        const uint64_t key = tt_key(search_hash, color, bot_color);
+        TTEntry entry;
+        const bool tt_hit = tt->probe(key, entry);
+        ++stats.tt_probes;
+        stats.tt_hits += tt_hit;
+        if (tt_hit && entry.depth >= rest_depth)
+        {
+            entry.score = tb_distance_shift(entry.score, depth);
+            if (entry.bound == Bound::EXACT || (entry.bound == Bound::LOWER && entry.score > beta) ||
+                (entry.bound == Bound::UPPER && entry.score < alpha))
+            {
+                ++stats.tt_cutoffs;
+                return entry.score;
+            }
+        }
+
+        // Отсечения бесперспективных узлов у горизонта (O2), только если нет
+        // взятий: тихий ход почти не меняет соотношение сил. Если оценка позиции
+        // даже с запасом margin не достает до окна, то за один ход до горизонта
+        // (futility pruning) узел не просматривается, а за два хода (razoring)
+        // просматривается на один ход и отсекается, если оценка осталась вне окна.
+        if (selective && rest_depth <= 2 && !find_beaters(color, search_pos) && find_movers(color, search_pos))
+        {
+            const double margin = rest_depth == 1 ? futility_margin : razor_margin;
+            const double static_score = calc_score(bot_color, potential);
+            ++stats.evals;
+            if (is_max ? static_score * margin < alpha : static_score > beta * margin)
+            {
+                if (rest_depth == 1)
+                    return static_score;
+                const double score = find_best_turns_rec<Options, Color>(
+                    color, depth, depth + 1, alpha, beta);
+                if (stopped || (is_max ? score < alpha : score > beta))
+                    return score;
+            }
+        }
+        const double alpha_before = alpha, beta_before = beta;
+
+        // Получение списка всех доступных ходов
+        TurnList &list = ply_turns[depth];
+        generate_turns(color, search_pos, list);
+        // Ключи порядка просмотра ходов
+        order_turns(list, color, depth, tt_hit ? &entry : nullptr);
+
+        double score = is_max ? -1 : INF;
+        // Оценка без взятия (stand pat): в форсированном поиске считается,
+        // что сторона может не начинать размен, если он ей невыгоден.
+        // Правила требуют бить, поэтому это приближение, которое только
+        // отсекает длинные размены раньше (по умолчанию выключено).
+        const bool use_stand_pat = stand_pat && depth >= horizon;
+        if (use_stand_pat)
+        {
+            score = calc_score(bot_color, potential);
+            ++stats.evals;
+            if (is_max ? score > beta : score < alpha)
+                return score;
+            if (is_max)
                 alpha = max(alpha, score);
+            else
+                beta = min(beta, score);
+        }
+        // Лучший из просмотренных ходов
+        int best = -1;
+        for (int i = 0; i < list.size; ++i)
+        {
+            // Следующий по порядку ход переставляется на место i
+            pick_next_turn(list, i);
+            const PackedTurn &next_turn = list.turns[i];
+            if (next_turn.beaten)
+                stats.max_capture_chain = max(stats.max_capture_chain, popcount(next_turn.beaten));
+
+            Undo undo;
+            make_turn(next_turn, color, undo);
+            double next_score;
+            // Поиск с главным вариантом (PVS): первый ход считается лучшим и ищется
+            // с полным окном, остальные проверяются нулевым окном, что они не лучше.
+            // Если проверка не прошла, то ход ищется заново с полным окном.
+            // На последнем уровне оценка и так точная, проверка не нужна.
+            if (use_pvs && best != -1 && depth + 1 < horizon)
+            {
+                const double bound = is_max ? alpha : beta;
+                // Сокращение поздних ходов (LMR, O2): тихие ходы в конце списка
+                // (не взятия, не превращения, не ходы из таблицы и не ходы-убийцы,
+                // у которых ключ порядка не меньше 1 << 41, и не ходы, после которых
+                // противник должен бить) проверяются с меньшей глубиной.
+                // Если ход оказался лучше, то проверка повторяется с полной глубиной.
+                const bool reduce = selective && i >= lmr_move_count && rest_depth >= lmr_min_depth &&
+                                    rest_depth > lmr_reduction && !next_turn.beaten && !next_turn.promotion &&
+                                    list.keys[i] < (1LL << 41) && !find_beaters(!color, search_pos);
+                if (reduce)
+                    next_score = find_best_turns_rec<Options, NextColor>(
+                        !color, depth + 1, horizon - lmr_reduction, bound, bound);
+                if (!reduce || (is_max ? next_score > alpha : next_score < beta))
+                    next_score = find_best_turns_rec<Options, NextColor>(
+                        !color, depth + 1, horizon, bound, bound);
+                if (is_max ? next_score > alpha && next_score <= beta : next_score < beta && next_score >= alpha)
+                    next_score = find_best_turns_rec<Options, NextColor>(
+                        !color, depth + 1, horizon, alpha, beta);
+            }
+            else
+                next_score = find_best_turns_rec<Options, NextColor>(
+                    !color, depth + 1, horizon, alpha, beta);
+            unmake_turn(next_turn, color, undo);
+
+            if ((best == -1 && !use_stand_pat) || (is_max ? next_score > score : next_score < score))
+            {
+                score = next_score;
+                best = i;
+            }
+            // альфа-бета отсечение
+            if (is_max ? score > beta : score < alpha)
+            {
+                ++stats.cutoffs;
+                stats.first_move_cutoffs += i == 0;
+                remember_cutoff(next_turn, color, depth, rest_depth);
+                break;
             }
-            return score;
+            if (is_max)
+                alpha = max(alpha, score);
+            else
+                beta = min(beta, score);
         }
+
+        // Оценка прерванного поиска неверна, ее нельзя сохранять
+        if (stopped)
+            return 0;
+
+        // Сохранить оценку в таблице транспозиций.
+        // Если оценка вышла за окно, то она является только границей;
+        // оценка на границе окна точная.
+        Bound bound = Bound::EXACT;
+        if (score < alpha_before)
+            bound = Bound::UPPER;
+        else if (score > beta_before)
+            bound = Bound::LOWER;
+        const double tt_score = tb_distance_shift(score, -depth);
+        if (best != -1)
+            tt->store(key, rest_depth, bound, tt_score, list.turns[best].from, list.turns[best].to,
+                      list.turns[best].beaten);
         else
+            tt->store(key, rest_depth, bound, tt_score, -1, -1, 0);
+        return score;
+    }
+
+    // Оценка значения value эндшпильной таблицы на глубине depth.
+    // bot_to_move - ходит ли бот. Чем быстрее выигрыш и чем дольше
+    // проигрыш, тем оценка лучше; ничья оценивается как равенство сил.
+    double tb_score(const int value, const int depth, const bool bot_to_move) const
+    {
+        if (!value)
+            return 1;
+        const int distance = depth + value - 1;
+        if (tb_is_win(value) == bot_to_move)
+            return TB_WIN - distance;
+        return -1 + distance * TB_LOSS_STEP;
+    }
+
+    // Сдвигает расстояние до конца партии в оценке score по эндшпильной
+    // таблице (см. tb_score) на plies ходов; остальные оценки не меняются.
+    // Оценка по таблице зависит от глубины узла, поэтому в таблице транспозиций
+    // она хранится с расстоянием от узла (plies = -depth), а при чтении
+    // на глубине depth снова считается от корня (plies = depth).
+    static double tb_distance_shift(const double score, const int plies)
+    {
+        if (score > TB_WIN - TB_MAX_PLY_DISTANCE && score <= TB_WIN)
+            return score - plies;
+        if (score > -1 && score < 0)
         {
-            // Минимизация для человека
-            double score = INF;
-            for (const auto& next_turn : res_turns)
+            // Расстояние восстанавливается целым, чтобы оценка после
+            // сдвига туда и обратно совпадала с tb_score до бита
+            const long distance = lround((score + 1) / TB_LOSS_STEP);
+            return -1 + (distance + plies) * TB_LOSS_STEP;
+        }
+        return score;
+    }
+
+    // Вычисляет ключи порядка просмотра ходов list в позиции поиска.
+    // Чем раньше просмотрен лучший ход, тем больше отсечений дает альфа-бета.
+    // Сначала идет лучший ход из таблицы транспозиций, затем взятия (чем больше
+    // побитых фигур, тем раньше) и превращения в дамку, затем ходы-убийцы,
+    // давшие отсечение на этой же глубине, остальные - по таблице истории.
+    void order_turns(TurnList &list, const bool color, const int depth, const TTEntry *entry) const
+    {
+        for (int i = 0; i < list.size; ++i)
+        {
+            const PackedTurn &t = list.turns[i];
+            int64_t key = history[color][t.from][t.to];
+            if (entry && entry->from == t.from && entry->to == t.to && entry->beaten == t.beaten)
+                key += 1LL << 60;
+            if (t.beaten)
+                key += (1LL << 50) + (int64_t(popcount(t.beaten) + popcount(t.beaten & search_pos.kings)) << 40);
+            if (t.promotion)
+                key += 1LL << 45;
+            if (!t.beaten)
             {
-                score = min(score, find_best_turns_rec(next_turn, !color, depth + 1, alpha, beta));
-                // альфа-бета отсечение
-                if (score < alpha)
-                    break;
-                beta = min(beta, score);
+                if (killers[depth][0] == make_pair(t.from, t.to))
+                    key += 1LL << 42;
+                else if (killers[depth][1] == make_pair(t.from, t.to))
+                    key += 1LL << 41;
             }
-            return score;
+            list.keys[i] = key;
         }
+    }
 
-        return 0;
+    // Переставляет на место i ход с наибольшим ключом среди ходов i, i + 1, ...
+    // Полная сортировка не нужна: после отсечения остальные ходы не просматриваются.
+    void pick_next_turn(TurnList &list, const int i) const
+    {
+        int best = i;
+        for (int j = i + 1; j < list.size; ++j)
+        {
+            if (list.keys[j] > list.keys[best])
+                best = j;
+        }
+        swap(list.turns[i], list.turns[best]);
+        swap(list.keys[i], list.keys[best]);
+    }
+
+    // Запоминает ход, давший отсечение, в таблицах ходов-убийц и истории.
+    // Ходы со взятием не запоминаются: они и так просматриваются первыми.
+    void remember_cutoff(const PackedTurn &turn, const bool color, const int depth, const int rest_depth)
+    {
+        if (turn.beaten)
+            return;
+        history[color][turn.from][turn.to] += rest_depth * rest_depth;
+        if (killers[depth][0] != make_pair(turn.from, turn.to))
+        {
+            killers[depth][1] = killers[depth][0];
+            killers[depth][0] = {turn.from, turn.to};
+        }
     }
 
+    // Очищает таблицы ходов-убийц и истории
+    void clear_order_stats()
+    {
+        for (auto &depth_killers : killers)
+            depth_killers[0] = depth_killers[1] = {-1, -1};
+        for (auto &color_history : history)
+            for (auto &from_history : color_history)
+                fill(begin(from_history), end(from_history), 0);
+    }
+
+    // Проверяет, не наступил ли крайний срок поиска и не пришел ли
+    // сигнал остановки от основного потока.
+    // Проверка делается раз в 1024 узла, чтобы не замедлять поиск.
+    bool time_is_over()
+    {
+        if (nodes < next_time_check)
+            return false;
+        next_time_check = nodes + 1024;
+        stopped = (stop_signal && stop_signal->load(memory_order_relaxed)) ||
+                  (use_deadline && chrono::steady_clock::now() >= deadline);
+        return stopped;
+    }
+
+    // Миллисекунды, прошедшие с момента start
+    static double elapsed_ms(const chrono::steady_clock::time_point start)
+    {
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    }
+
+    // Ключ позиции в таблице транспозиций.
+    // Учитывает, чей ход и за какой цвет играет бот.
+    uint64_t tt_key(const uint64_t hash, const bool color, const bool bot_color) const
+    {
+        return hash ^ (color ? zobrist().black_move : 0) ^ (bot_color ? zobrist().black_bot : 0);
+    }
+
+public:
     // Функция для нахождения всех доступных ходов для игрока заданного цвета.
     // Один ход может состоять из нескольких перемещений при взятии нескольких фигур.
-    vector<Turn> find_series(const bool color, vector<vector<POS_T>> mtx)
+    vector<Turn> find_series(const bool color, const Position &pos)
     {
         // Получение списка доступных начальных перемещений
         vector<move_pos> moves;
-        find_turns(color);
+        find_turns(color, pos);
         moves = turns;
         bool have_beats_now = have_beats;
 
@@ -214,8 +1051,8 @@ private:
             // Добавить начальное перемещение
             // в список перемещений полного хода
             Turn turn;
-            turn.series.push_back(move);
-            turn.final_mtx = make_turn(mtx, move);
+            turn.final_pos = pos;
+            make_turn(turn, move);
 
             // Если доступные ходы со взятием
             if (have_beats_now)
@@ -232,7 +1069,7 @@ private:
                     Turn t = q.front(); q.pop();                    
 
                     // Найти для него дальнейшие возможные перемещения
-                    find_turns(t.last().x2, t.last().y2, t.final_mtx);
+                    find_turns(t.last().x2, t.last().y2, t.final_pos);
                     if (have_beats)
                     {
                         // Эсли эти перемещения тоже со взятием
@@ -242,8 +1079,7 @@ private:
                             // добавлем каждое перемещение к списку перемещений 
                             // этого неполного хода
                             Turn new_turn = t;
-                            new_turn.series.push_back(m);
-                            new_turn.final_mtx = make_turn(t.final_mtx, m);
+                            make_turn(new_turn, m);
                             q.push(new_turn);
                         }
                     }
@@ -266,179 +1102,262 @@ private:
         return turns_series;
     }
 
-public:
-    // Найти допустимые ходы для игрока заданного цвета.
-    // Список ходов сохраняется в поле turns.
-    void find_turns(const bool color)
+private:
+    // Продолжает серию взятий фигурой, начавшей ход на клетке from и стоящей
+    // сейчас на клетке sq позиции pos (побитые фигуры уже сняты с доски).
+    // Законченные серии добавляются в list. Серии, которые отличаются только
+    // порядком взятий и приводят к одной позиции, добавляются один раз.
+    void add_beat_series(TurnList &list, const int8_t from, const int sq, const Position &pos, const uint32_t beaten,
+                         const bool promotion) const
     {
-        find_turns(color, board->get_board());
+        const uint32_t bit = 1u << sq;
+        const bool color = (pos.black & bit) != 0;
+        const bool is_king = (pos.kings & bit) != 0;
+        const uint32_t empty = pos.empty();
+        const uint32_t enemy = pos.pieces(!color);
+        bool can_beat = false;
+
+        for (int d = 0; d < 4; ++d)
+        {
+            const Dir dir = Dir(d);
+            uint32_t cur = shift(bit, dir);
+            // Дамка может бить фигуру на любом расстоянии по диагонали
+            if (is_king)
+            {
+                while (cur & empty)
+                    cur = shift(cur, dir);
+            }
+            // На пути должна стоять фигура противоположного цвета
+            if (!(cur & enemy))
+                continue;
+            const uint32_t victim = cur;
+            // Пешка встает сразу за побитой фигурой,
+            // дамка - на любую свободную клетку за ней
+            for (cur = shift(cur, dir); cur & empty; cur = shift(cur, dir))
+            {
+                can_beat = true;
+                Position next = pos;
+                next.white &= ~victim;
+                next.black &= ~victim;
+                next.kings &= ~victim;
+                uint32_t &own = color ? next.black : next.white;
+                own = (own & ~bit) | cur;
+                next.kings &= ~bit;
+                const bool promoted = !is_king && (cur & (color ? BOTTOM_ROW : TOP_ROW));
+                if (is_king || promoted)
+                    next.kings |= cur;
+                add_beat_series(list, from, lowest_bit(cur), next, beaten | victim, promotion || promoted);
+                if (!is_king)
+                    break;
+            }
+        }
+        if (can_beat || !beaten)
+            return;
+
+        // Серия закончена
+        for (int i = 0; i < list.size; ++i)
+        {
+            const PackedTurn &t = list.turns[i];
+            if (t.from == from && t.to == sq && t.beaten == beaten && t.promotion == promotion)
+                return;
+        }
+        PackedTurn turn;
+        turn.beaten = beaten;
+        turn.from = from;
+        turn.to = int8_t(sq);
+        turn.promotion = promotion;
+        list.add(turn);
     }
 
-    // Найти допустимые ходы для заданой фигуры.
-    // Список ходов сохраняется в поле turns.
-    void find_turns(const POS_T x, const POS_T y)
+public:
+    // Находит все полные ходы игрока color в позиции pos и записывает их в list.
+    // В отличие от find_series не выделяет память: серии взятий перебираются
+    // рекурсивно с копией позиции на стеке, а ходы записываются упакованными.
+    void generate_turns(const bool color, const Position &pos, TurnList &list) const
     {
-        find_turns(x, y, board->get_board());
+        list.size = 0;
+        const uint32_t beaters = find_beaters(color, pos);
+        if (beaters)
+        {
+            for (uint32_t bb = beaters; bb; bb &= bb - 1)
+            {
+                const int8_t from = int8_t(lowest_bit(bb));
+                add_beat_series(list, from, from, pos, 0, false);
+            }
+            return;
+        }
+
+        const uint32_t empty = pos.empty();
+        for (uint32_t bb = find_movers(color, pos); bb; bb &= bb - 1)
+        {
+            const int8_t from = int8_t(lowest_bit(bb));
+            const bool is_king = (pos.kings & (1u << from)) != 0;
+            for (int d = 0; d < 4; ++d)
+            {
+                const Dir dir = Dir(d);
+                // Пешка ходит только вперед
+                if (!is_king && (dir == UP_LEFT || dir == UP_RIGHT) == color)
+                    continue;
+                for (uint32_t cur = shift(1u << from, dir); cur & empty; cur = shift(cur, dir))
+                {
+                    PackedTurn turn;
+                    turn.from = from;
+                    turn.to = int8_t(lowest_bit(cur));
+                    turn.promotion = !is_king && (cur & (color ? BOTTOM_ROW : TOP_ROW));
+                    list.add(turn);
+                    if (!is_king)
+                        break;
+                }
+            }
+        }
     }
 
-private:
     // Найти допустимые ходы для игрока заданного цвета.
     // Список ходов сохраняется в поле turns.
-    void find_turns(const bool color, const vector<vector<POS_T>> &mtx)
+    void find_turns(const bool color, const Position &pos)
     {
-        vector<move_pos> res_turns; // Список ходов
+        turns.clear();
 
-        // Если в ходе нахождения ходов обнаружился ход со взятием,
+        // Если у игрока есть ход со взятием,
         // то допустимыми ходами являются только ходы со взятием.
-        bool have_beats_before = false;
+        // Маски фигур, которые могут бить и могут ходить, 
+        // находятся сдвигами сразу для всех фигур.
+        const uint32_t beaters = find_beaters(color, pos);
+        have_beats = beaters != 0;
+        const uint32_t movers = have_beats ? beaters : find_movers(color, pos);
 
-        // Проверка каждой клетки доски
-        for (POS_T i = 0; i < 8; ++i)
+        // Перебор найденных фигур
+        for (uint32_t bb = movers; bb; bb &= bb - 1)
         {
-            for (POS_T j = 0; j < 8; ++j)
-            {
-                // Здесь очень путаное определение цвета фигуры на клетке.
-                // 0 означает нет фигуры, 1 - белая пешка, 2 - черная пешка,
-                // 3 - белая дамка, 4 - черная дамка. 
-                // А color == false означает белый цвет.
-                if (mtx[i][j] && mtx[i][j] % 2 != color)
-                {
-                    // Если на клетке фигура заданного цвета, то найти возможные
-                    // ходы для этой фигуры
-                    find_turns(i, j, mtx);
-
-                    // если нашелся ход со взятием, а перед этим не было ходов
-                    // со взятием, то ходы, найденные ранее, становятся не валидными
-                    if (have_beats && !have_beats_before)
-                    {
-                        have_beats_before = true;
-                        res_turns.clear();
-                    }
-
-                    // Добавить найденные ходы в итоговый список
-                    if ((have_beats_before && have_beats) || !have_beats_before)
-                    {
-                        res_turns.insert(res_turns.end(), turns.begin(), turns.end());
-                    }
-                }
-            }
+            if (have_beats)
+                add_beats(lowest_bit(bb), pos);
+            else
+                add_moves(lowest_bit(bb), pos);
         }
-        // Сохранить ходы в поле turns
-        turns = res_turns;
-        // Перемешать список ходов
-        shuffle(turns.begin(), turns.end(), rand_eng);
-        // Ходы со взятием или простые
-        have_beats = have_beats_before;
     }
 
     // Найти допустимые ходы для заданой фигуры.
     // Список ходов сохраняется в поле turns.
-    void find_turns(const POS_T x, const POS_T y, const vector<vector<POS_T>> &mtx)
+    void find_turns(const POS_T x, const POS_T y, const Position &pos)
     {
-        // Очистить список ходов и флаг взятия
+        // Очистить список ходов
         turns.clear();
-        have_beats = false;
-
-        // Тип фигуры на клетке.
-        // 0 означает нет фигуры, 1 - белая пешка, 2 - черная пешка,
-        // 3 - белая дамка, 4 - черная дамка. 
-        POS_T type = mtx[x][y];
-
-        // Проверка на возможность взятия
-        switch (type)
-        {
-        case 1:
-        case 2:
-            // Проверка для пешки.
-            // Можно ли походить через одну клетку по диагонали,
-            // и есть ли на промежуточной клетке фигура 
-            // противоположного цвета
-            for (POS_T i = x - 2; i <= x + 2; i += 4)
-            {
-                for (POS_T j = y - 2; j <= y + 2; j += 4)
-                {
-                    if (i < 0 || i > 7 || j < 0 || j > 7)
-                        continue;
-                    POS_T xb = (x + i) / 2, yb = (y + j) / 2;
-                    if (mtx[i][j] || !mtx[xb][yb] || mtx[xb][yb] % 2 == type % 2)
-                        continue;
-                    turns.emplace_back(x, y, i, j, xb, yb);
-                }
-            }
-            break;
-        default:
-            // Проверка для дамки.
-            // Проверка всех возможных позиций по диагоналям,
-            // и есть ли на промежуточной клетке фигура 
-            // противоположного цвета
-            for (POS_T i = -1; i <= 1; i += 2)
-            {
-                for (POS_T j = -1; j <= 1; j += 2)
-                {
-                    POS_T xb = -1, yb = -1;
-                    for (POS_T i2 = x + i, j2 = y + j; i2 != 8 && j2 != 8 && i2 != -1 && j2 != -1; i2 += i, j2 += j)
-                    {
-                        if (mtx[i2][j2])
-                        {
-                            if (mtx[i2][j2] % 2 == type % 2 || (mtx[i2][j2] % 2 != type % 2 && xb != -1))
-                            {
-                                break;
-                            }
-                            xb = i2;
-                            yb = j2;
-                        }
-                        if (xb != -1 && xb != i2)
-                        {
-                            turns.emplace_back(x, y, i2, j2, xb, yb);
-                        }
-                    }
-                }
-            }
-            break;
-        }
 
         // Если найдены ходы со взятиями, то простые ходы
         // проверять не нужно
-        if (!turns.empty())
+        have_beats = add_beats(square(x, y), pos);
+        if (!have_beats)
+            add_moves(square(x, y), pos);
+    }
+
+private:
+    // Маска фигур заданного цвета, у которых есть ход со взятием
+    uint32_t find_beaters(const bool color, const Position &pos) const
+    {
+        const uint32_t empty = pos.empty();
+        const uint32_t enemy = pos.pieces(!color);
+        const uint32_t men = pos.pieces(color) & ~pos.kings;
+        const uint32_t kings = pos.pieces(color) & pos.kings;
+
+        uint32_t res = 0;
+        for (int d = 0; d < 4; ++d)
         {
-            have_beats = true;
-            return;
+            const Dir back = opposite(Dir(d));
+            // Фигуры противника, за которыми в направлении d есть свободная клетка
+            const uint32_t targets = shift(empty, back) & enemy;
+            // Пешка бьет, если стоит вплотную к такой фигуре
+            uint32_t ray = shift(targets, back);
+            res |= ray & men;
+            // Дамка бьет, если между ней и такой фигурой только свободные клетки
+            while (ray)
+            {
+                res |= ray & kings;
+                ray = shift(ray & empty, back);
+            }
         }
+        return res;
+    }
+
+    // Маска фигур заданного цвета, у которых есть ход без взятия
+    uint32_t find_movers(const bool color, const Position &pos) const
+    {
+        const uint32_t empty = pos.empty();
+        const uint32_t men = pos.pieces(color) & ~pos.kings;
+        const uint32_t kings = pos.pieces(color) & pos.kings;
 
-        // Проверка простых ходов
-        switch (type)
+        // Пешки ходят только вперед, белые - вверх, черные - вниз
+        const Dir left = color ? DOWN_LEFT : UP_LEFT;
+        const Dir right = color ? DOWN_RIGHT : UP_RIGHT;
+        uint32_t res = men & (shift(empty, opposite(left)) | shift(empty, opposite(right)));
+
+        // Дамки ходят в любую сторону
+        for (int d = 0; d < 4; ++d)
+            res |= kings & shift(empty, Dir(d));
+        return res;
+    }
+
+    // Добавить в turns ходы со взятием для фигуры на клетке sq.
+    // Возвращает true, если такие ходы есть.
+    bool add_beats(const int sq, const Position &pos)
+    {
+        const uint32_t from = 1u << sq;
+        const uint32_t empty = pos.empty();
+        const uint32_t enemy = pos.pieces(!(pos.black & from));
+        const size_t size_before = turns.size();
+
+        for (int d = 0; d < 4; ++d)
         {
-        case 1:
-        case 2:
-            // Проверка для пешки.
-            // Допустимый ход - вперед по диагонали на соседнюю пустую клетку
+            const Dir dir = Dir(d);
+            uint32_t cur = shift(from, dir);
+            // Дамка может бить фигуру на любом расстоянии по диагонали
+            if (pos.kings & from)
             {
-                POS_T i = ((type % 2) ? x - 1 : x + 1);
-                for (POS_T j = y - 1; j <= y + 1; j += 2)
-                {
-                    if (i < 0 || i > 7 || j < 0 || j > 7 || mtx[i][j])
-                        continue;
-                    turns.emplace_back(x, y, i, j);
-                }
-                break;
+                while (cur & empty)
+                    cur = shift(cur, dir);
             }
-        default:
-            // Проверка для дамки.
-            // Допустимый ход - в любую сторону по диагонали на любую пустую клетку,
-            // между начальной и конечной позицией не должно быть других фигур.
-            for (POS_T i = -1; i <= 1; i += 2)
+            // На пути должна стоять фигура противоположного цвета
+            if (!(cur & enemy))
+                continue;
+            const int beaten = lowest_bit(cur);
+            cur = shift(cur, dir);
+            // Пешка встает сразу за побитой фигурой,
+            // дамка - на любую свободную клетку за ней
+            while (cur & empty)
             {
-                for (POS_T j = -1; j <= 1; j += 2)
-                {
-                    for (POS_T i2 = x + i, j2 = y + j; i2 != 8 && j2 != 8 && i2 != -1 && j2 != -1; i2 += i, j2 += j)
-                    {
-                        if (mtx[i2][j2])
-                            break;
-                        turns.emplace_back(x, y, i2, j2);
-                    }
-                }
+                const int to = lowest_bit(cur);
+                turns.emplace_back(square_x(sq), square_y(sq), square_x(to), square_y(to), square_x(beaten),
+                                   square_y(beaten));
+                if (!(pos.kings & from))
+                    break;
+                cur = shift(cur, dir);
+            }
+        }
+        return turns.size() != size_before;
+    }
+
+    // Добавить в turns ходы без взятия для фигуры на клетке sq
+    void add_moves(const int sq, const Position &pos)
+    {
+        const uint32_t from = 1u << sq;
+        const uint32_t empty = pos.empty();
+        const bool is_king = (pos.kings & from) != 0;
+        const bool is_black = (pos.black & from) != 0;
+
+        for (int d = 0; d < 4; ++d)
+        {
+            const Dir dir = Dir(d);
+            // Пешка ходит только вперед
+            if (!is_king && (dir == UP_LEFT || dir == UP_RIGHT) == is_black)
+                continue;
+            // Пешка ходит на соседнюю клетку, дамка - на любую
+            // свободную клетку по диагонали до первой фигуры
+            for (uint32_t cur = shift(from, dir); cur & empty; cur = shift(cur, dir))
+            {
+                const int to = lowest_bit(cur);
+                turns.emplace_back(square_x(sq), square_y(sq), square_x(to), square_y(to));
+                if (!is_king)
+                    break;
             }
-            break;
         }
     }
 
@@ -449,20 +1368,78 @@ private:
     bool have_beats = false;
     // Максимальная глубина рекурсии.
     int Max_depth = 0;
+    // Счетчик просмотренных узлов
+    uint64_t nodes = 0;
+    // Счетчик узлов, оценка которых взята из эндшпильных таблиц
+    uint64_t tb_hits = 0;
+    // Статистика последнего вызова find_best_turns (основной поток)
+    SearchStats stats;
 
   private:
     // ГПСЧ
     default_random_engine rand_eng;
     // Режим оценки силы позиции
     string scoring_mode;
+    // Учитывать продвижение пешек (режим "NumberAndPotential")
+    bool with_potential = false;
+    // Поиск специализированным по настройкам и цветам ядром
+    bool specialized = true;
+    // Ядро поиска, выбранное для текущего поиска
+    Kernel kernel = nullptr;
     // Оптимизация алгоритма определения лучшего хода для бота
     string optimization;
+    // Поиск с главным вариантом и окнами стремления (O1 и выше),
+    // при O0 - обычный альфа-бета поиск
+    bool use_pvs = false;
+    // Выборочный поиск (O2): сокращение поздних ходов и отсечения у горизонта
+    bool selective = false;
+    // Сокращение поздних ходов: с какой оставшейся глубины оно применяется,
+    // сколько первых ходов просматриваются полностью и на сколько сокращается глубина
+    int lmr_min_depth = 3, lmr_move_count = 3, lmr_reduction = 2;
+    // Запас оценки (во сколько раз она может измениться) для отсечений
+    // за один (futility) и за два (razoring) хода до горизонта
+    double futility_margin = 1.1, razor_margin = 1.3;
+    // Предельное количество ходов форсированного поиска взятий (0 - не искать)
+    int quiescence_max_ply = 0;
+    // Оценка без взятия в форсированном поиске
+    bool stand_pat = false;
+    // Таблица транспозиций, общая для всех потоков поиска
+    shared_ptr<TTable> tt;
+    // Эндшпильные таблицы (nullptr, если их нет)
+    shared_ptr<const Tablebase> tablebase;
+    // Дебютная книга (nullptr, если ее нет)
+    shared_ptr<const Book> book;
+    // Количество потоков поиска
+    int threads = 1;
+    // Сигнал остановки для вспомогательных потоков поиска
+    const atomic<bool> *stop_signal = nullptr;
+    // Ограничение времени на ход в миллисекундах (0 - нет ограничения)
+    unsigned int time_limit_ms = 0;
+    // Крайний срок текущего поиска
+    chrono::steady_clock::time_point deadline;
+    // Флаг проверки крайнего срока
+    bool use_deadline = false;
+    // Флаг прерывания поиска по времени
+    bool stopped = false;
+    // Значение счетчика узлов, при котором нужно проверить время
+    uint64_t next_time_check = 0;
+    // Позиция, в которой поиск делает и отменяет ходы, и ее хэш
+    Position search_pos;
+    uint64_t search_hash = 0;
+    // Слагаемые оценки позиции поиска
+    Eval search_eval;
+    // Буферы списков ходов для каждого уровня поиска
+    vector<TurnList> ply_turns = vector<TurnList>(MAX_PLY);
+    // Ходы-убийцы: для каждой глубины два последних хода без взятия
+    // (начальная и конечная клетки), давших отсечение
+    pair<int8_t, int8_t> killers[MAX_PLY][2];
+    // Таблица истории: для каждого цвета и пары клеток (откуда, куда)
+    // суммарный вес отсечений, которые дал такой ход
+    uint32_t history[2][32][32];
     // Следующий ход для бота
     vector<move_pos> next_move;
     // Список лучших состояний
     vector<int> next_best_state;
-    // Ссылка на объект игрового поля
-    Board *board;
     // Ссылка на настройки
     Config *config;
 };
@@ -0,0 +1,138 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+// Файл, отображенный в память только для чтения.
+// Данные не загружаются при открытии: страницы подгружаются
+// операционной системой при первом обращении и являются общими
+// для всех процессов, которые отображают тот же файл.
+class MappedFile
+{
+  public:
+    MappedFile() = default;
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile(MappedFile &&other) noexcept
+    {
+        swap_with(other);
+    }
+
+    MappedFile &operator=(MappedFile &&other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            swap_with(other);
+        }
+        return *this;
+    }
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    // Отображает файл path в память. Возвращает false, если файл
+    // не удалось открыть или он пустой.
+    bool open(const std::string &path)
+    {
+        close();
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+        {
+            CloseHandle(file);
+            return false;
+        }
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (!mapping)
+            return false;
+        void *ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if (!ptr)
+            return false;
+        size_ = size_t(file_size.QuadPart);
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        void *ptr = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (ptr == MAP_FAILED)
+            return false;
+        size_ = size_t(st.st_size);
+#endif
+        data_ = static_cast<const uint8_t *>(ptr);
+        return true;
+    }
+
+    // Сообщает системе, что файл будет читаться последовательно:
+    // страницы читаются с диска заранее и вытесняются сразу после чтения
+    void advise_sequential() const
+    {
+#ifndef _WIN32
+        if (data_)
+            madvise(const_cast<uint8_t *>(data_), size_, MADV_SEQUENTIAL);
+#endif
+    }
+
+    // Снимает отображение файла
+    void close()
+    {
+        if (!data_)
+            return;
+#ifdef _WIN32
+        UnmapViewOfFile(data_);
+#else
+        munmap(const_cast<uint8_t *>(data_), size_);
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    const uint8_t *data() const
+    {
+        return data_;
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+  private:
+    void swap_with(MappedFile &other)
+    {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+    }
+
+    const uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+};
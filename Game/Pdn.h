@@ -0,0 +1,455 @@
+#pragma once
+#include <ctype.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../Models/Position.h"
+#include "History.h"
+#include "Logic.h"
+#include "MappedFile.h"
+
+using namespace std;
+
+// Партии в формате PDN (Portable Draughts Notation) для русских шашек
+// (GameType 25): теги заголовка в квадратных скобках, затем ходы
+// в алгебраической записи "c3-d4", взятия "c3:e5:g3", и результат
+// "1-0", "0-1", "1/2-1/2" или "*". Начальная позиция, если она
+// не стандартная, задается тегами SetUp "1" и FEN (см. Position::from_fen).
+
+// Начальная позиция русских шашек
+const string PDN_START_FEN = "W:Wa1,c1,e1,g1,b2,d2,f2,h2,a3,c3,e3,g3:Bb6,d6,f6,h6,a7,c7,e7,g7,b8,d8,f8,h8";
+
+// Ширина строки ходов при записи
+const size_t PDN_LINE_WIDTH = 80;
+
+// Является ли слово результатом партии (им заканчивается запись ходов).
+// Кроме результатов PGN принимаются результаты в очках шашек: "2-0", "0-2", "1-1".
+inline bool is_pdn_result(const string_view token)
+{
+    for (const char *result : {"1-0", "0-1", "1/2-1/2", "2-0", "0-2", "1-1", "*"})
+    {
+        if (token == result)
+            return true;
+    }
+    return false;
+}
+
+// Пробельный символ (isspace зависит от локали и медленнее)
+inline bool is_pdn_space(const char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\v';
+}
+
+// Конец слова в записи ходов: пробел, комментарий или вариант
+inline bool is_pdn_delimiter(const char c)
+{
+    return is_pdn_space(c) || c == '{' || c == '}' || c == '(' || c == ')' || c == ';';
+}
+
+// Запись хода (серии перемещений) в формате PDN, например "c3-d4" или "c3:e5:g3"
+inline string pdn_move(const vector<move_pos> &series)
+{
+    string res = square_name(square(series.front().x, series.front().y));
+    for (const auto &move : series)
+    {
+        res += move.xb != -1 ? ':' : '-';
+        res += square_name(square(move.x2, move.y2));
+    }
+    return res;
+}
+
+// Запись партии из истории history в формате PDN.
+// tags - теги заголовка (GameType, SetUp, FEN и Result добавляются сами),
+// result - результат, start_color - кто ходит первым в начале партии.
+// Если старые ходы сложены в начальную позицию истории (GameHistory::set_undo_depth),
+// то запись начинается с этой позиции с продолжением нумерации ходов.
+inline string pdn_from_history(const GameHistory &history, const vector<pair<string, string>> &tags,
+                               const string &result, const bool start_color = false)
+{
+    string res;
+    auto add_tag = [&res](const string &name, const string &value) {
+        res += '[' + name + " \"";
+        for (const char c : value)
+        {
+            if (c == '"' || c == '\\')
+                res += '\\';
+            res += c;
+        }
+        res += "\"]\n";
+    };
+    for (const auto &tag : tags)
+        add_tag(tag.first, tag.second);
+    add_tag("GameType", "25");
+    const size_t folded = history.folded_moves();
+    const bool base_color = (start_color + folded) % 2;
+    const string fen = history.position_at(0).to_fen(base_color);
+    if (fen != PDN_START_FEN)
+    {
+        add_tag("SetUp", "1");
+        add_tag("FEN", fen);
+    }
+    add_tag("Result", result);
+    res += '\n';
+
+    // Ходы: шаги одной серии взятий (номер взятия больше 1) - один ход
+    size_t line_start = res.size();
+    auto add_word = [&](const string &word) {
+        if (res.size() > line_start)
+        {
+            if (res.size() - line_start + 1 + word.size() > PDN_LINE_WIDTH)
+            {
+                res += '\n';
+                line_start = res.size();
+            }
+            else
+                res += ' ';
+        }
+        res += word;
+    };
+    const auto &steps = history.steps();
+    bool color = base_color;
+    int move_num = int(1 + (start_color + folded) / 2);
+    for (size_t i = 0; i < history.size();)
+    {
+        string word;
+        if (!color)
+            word = to_string(move_num) + ". ";
+        else if (i == 0)
+            word = to_string(move_num) + "... ";
+        word += square_name(steps[i].from);
+        do
+        {
+            word += steps[i].is_capture() ? ':' : '-';
+            word += square_name(steps[i].to);
+            ++i;
+        } while (i < history.size() && steps[i].beat_series() > 1);
+        add_word(word);
+        if (color)
+            ++move_num;
+        color = !color;
+    }
+    add_word(result);
+    res += "\n\n";
+    return res;
+}
+
+// Партия из файла PDN без разбора ходов. Теги и ходы указывают прямо
+// в отображенный в память файл, поэтому действительны, пока открыт PdnReader.
+// Значения тегов хранятся как в файле (с экранированием \" и \\).
+struct PdnRecord
+{
+    vector<pair<string_view, string_view>> tags;
+    string_view movetext;
+    // Смещение начала партии в файле
+    size_t offset = 0;
+
+    // Значение тега name (пустое, если тега нет)
+    string_view tag(const string_view name) const
+    {
+        for (const auto &t : tags)
+        {
+            if (t.first == name)
+                return t.second;
+        }
+        return {};
+    }
+};
+
+// Чтение партий из файла PDN по одной.
+// Файл отображается в память (MappedFile), а не загружается: партии
+// читаются последовательно, страницы подгружаются по мере чтения
+// и могут вытесняться после него, поэтому размер файла может
+// быть больше памяти. Строки из файла не копируются (см. PdnRecord).
+class PdnReader
+{
+  public:
+    // Открывает файл path. Возвращает false, если файл не удалось открыть.
+    bool open(const string &path)
+    {
+        pos = 0;
+        if (!file.open(path))
+            return false;
+        file.advise_sequential();
+        text = string_view(reinterpret_cast<const char *>(file.data()), file.size());
+        // Пропустить метку порядка байтов UTF-8
+        if (text.substr(0, 3) == "\xEF\xBB\xBF")
+            pos = 3;
+        return true;
+    }
+
+    // Читает следующую партию в record. Возвращает false, если партий больше нет.
+    // Бросает runtime_error при ошибке в заголовке партии.
+    bool next(PdnRecord &record)
+    {
+        record.tags.clear();
+        record.movetext = {};
+        skip_space();
+        if (pos >= text.size())
+            return false;
+        record.offset = pos;
+        while (pos < text.size() && text[pos] == '[')
+        {
+            record.tags.push_back(read_tag());
+            skip_space();
+        }
+        const size_t start = pos;
+        record.movetext = text.substr(start, skip_movetext() - start);
+        return true;
+    }
+
+    // Смещение в файле, с которого будет прочитана следующая партия
+    size_t position() const
+    {
+        return pos;
+    }
+
+    // Продолжить чтение со смещения offset (начала партии, см. PdnRecord::offset)
+    void seek(const size_t offset)
+    {
+        pos = min(offset, text.size());
+    }
+
+    size_t size() const
+    {
+        return text.size();
+    }
+
+  private:
+    void skip_space()
+    {
+        while (pos < text.size() && is_pdn_space(text[pos]))
+            ++pos;
+    }
+
+    // Ошибка в заголовке: чтение продолжится со следующей строки
+    [[noreturn]] void fail(const string &what)
+    {
+        const string message = "PDN error at byte " + to_string(pos) + ": " + what;
+        const size_t end = text.find('\n', pos);
+        pos = end == string_view::npos ? text.size() : end + 1;
+        throw runtime_error(message);
+    }
+
+    // Тег [Name "value"]
+    pair<string_view, string_view> read_tag()
+    {
+        ++pos;
+        skip_space();
+        const size_t name_start = pos;
+        while (pos < text.size() && !is_pdn_space(text[pos]) && text[pos] != '"' && text[pos] != ']')
+            ++pos;
+        const string_view name = text.substr(name_start, pos - name_start);
+        skip_space();
+        if (pos >= text.size() || text[pos] != '"')
+            fail("tag value must be quoted");
+        const size_t value_start = ++pos;
+        while (pos < text.size() && text[pos] != '"' && text[pos] != '\n')
+            pos += text[pos] == '\\' ? 2 : 1;
+        if (pos >= text.size() || text[pos] != '"')
+            fail("unterminated tag value");
+        const string_view value = text.substr(value_start, pos - value_start);
+        ++pos;
+        skip_space();
+        if (pos >= text.size() || text[pos] != ']')
+            fail("tag must end with ]");
+        ++pos;
+        return {name, value};
+    }
+
+    // Пропускает ходы до результата партии, до заголовка следующей партии
+    // или до конца файла. Возвращает конец записи ходов.
+    size_t skip_movetext()
+    {
+        int depth = 0;
+        while (pos < text.size())
+        {
+            const char c = text[pos];
+            if (c == '{')
+            {
+                const size_t end = text.find('}', pos);
+                pos = end == string_view::npos ? text.size() : end + 1;
+            }
+            else if (c == ';')
+            {
+                const size_t end = text.find('\n', pos);
+                pos = end == string_view::npos ? text.size() : end + 1;
+            }
+            else if (c == '(' || c == ')')
+            {
+                depth += c == '(' ? 1 : -1;
+                ++pos;
+            }
+            else if (c == '[' && depth == 0 && (pos == 0 || text[pos - 1] == '\n' || text[pos - 1] == '\r'))
+            {
+                // Заголовок следующей партии: у этой нет результата
+                return pos;
+            }
+            else if (is_pdn_space(c))
+                ++pos;
+            else
+            {
+                const size_t start = pos;
+                while (pos < text.size() && !is_pdn_delimiter(text[pos]))
+                    ++pos;
+                if (depth == 0 && strchr("012*", c) && is_pdn_result(text.substr(start, pos - start)))
+                    return pos;
+            }
+        }
+        return pos;
+    }
+
+    MappedFile file;
+    string_view text;
+    size_t pos = 0;
+};
+
+// Партия, ходы которой проверены генератором ходов бота
+struct PdnGame
+{
+    Position start;
+    // Кто ходит первым (false - белые)
+    bool start_color = false;
+    // Ходы партии; позиция после хода - final_pos
+    vector<Turn> turns;
+    // Результат из записи ходов или тега Result ("*", если его нет)
+    string result = "*";
+};
+
+// Разбирает ходы партии record и проверяет каждый ход, находя его среди
+// ходов генератора Logic::find_series. Взятие можно записать только
+// начальной и конечной клетками, если это не приводит к неоднозначности.
+// Бросает runtime_error с номером хода, если ход не найден или записан неверно.
+inline PdnGame replay_pdn(const PdnRecord &record, Logic &logic)
+{
+    PdnGame game;
+    const string_view game_type = record.tag("GameType");
+    if (!game_type.empty() && game_type.substr(0, 2) != "25")
+        throw runtime_error("PDN game at byte " + to_string(record.offset) + ": unsupported GameType " +
+                            string(game_type));
+    const string_view fen = record.tag("FEN");
+    game.start = Position::from_fen(fen.empty() ? PDN_START_FEN : string(fen), game.start_color);
+    const string_view result_tag = record.tag("Result");
+    if (!result_tag.empty())
+        game.result = string(result_tag);
+
+    Position pos = game.start;
+    bool color = game.start_color;
+    const string_view text = record.movetext;
+    size_t i = 0;
+    int depth = 0;
+    int squares[16];
+    while (i < text.size())
+    {
+        const char c = text[i];
+        if (c == '{' || c == ';')
+        {
+            const size_t end = text.find(c == '{' ? '}' : '\n', i);
+            i = end == string_view::npos ? text.size() : end + 1;
+            continue;
+        }
+        if (c == '(' || c == ')')
+        {
+            depth += c == '(' ? 1 : -1;
+            ++i;
+            continue;
+        }
+        if (is_pdn_space(c))
+        {
+            ++i;
+            continue;
+        }
+        const size_t start = i;
+        while (i < text.size() && !is_pdn_delimiter(text[i]))
+            ++i;
+        string_view token = text.substr(start, i - start);
+        // Варианты и оценки ходов ($1) пропускаются
+        if (depth > 0 || token[0] == '$')
+            continue;
+        if (is_pdn_result(token))
+        {
+            game.result = string(token);
+            break;
+        }
+        // Номер хода "12." или "12..." может быть слитно с ходом
+        size_t skip = 0;
+        while (skip < token.size() && isdigit((unsigned char)token[skip]))
+            ++skip;
+        if (skip < token.size() && token[skip] == '.')
+        {
+            while (skip < token.size() && token[skip] == '.')
+                ++skip;
+            token.remove_prefix(skip);
+        }
+        // Знаки оценки хода после него ("c3-d4!?")
+        while (!token.empty() && strchr("!?+#", token.back()))
+            token.remove_suffix(1);
+        if (token.empty())
+            continue;
+
+        auto error = [&](const string &what) {
+            return runtime_error("PDN game at byte " + to_string(record.offset) + ", move " +
+                                 to_string(game.turns.size() + 1) + " '" + string(token) + "': " + what);
+        };
+        // Клетки хода через '-' или ':' ('x')
+        int count = 0;
+        bool capture = false;
+        for (size_t k = 0; k < token.size(); k += 3)
+        {
+            if (count == 16 || k + 1 >= token.size() || token[k] < 'a' || token[k] > 'h' || token[k + 1] < '1' ||
+                token[k + 1] > '8')
+                throw error("bad move notation");
+            const POS_T x = POS_T('8' - token[k + 1]), y = POS_T(token[k] - 'a');
+            if ((x + y) % 2 == 0)
+                throw error("light square");
+            squares[count++] = square(x, y);
+            if (k + 2 < token.size())
+            {
+                if (!strchr("-:x", token[k + 2]))
+                    throw error("bad move notation");
+                capture = capture || token[k + 2] != '-';
+            }
+        }
+        if (count < 2)
+            throw error("bad move notation");
+
+        // Поиск хода среди допустимых: все клетки серии взятий или только начало и конец
+        const vector<Turn> turns = logic.find_series(color, pos);
+        const Turn *found = nullptr;
+        bool ambiguous = false;
+        for (const Turn &turn : turns)
+        {
+            const auto &series = turn.series;
+            if (square(series[0].x, series[0].y) != squares[0] ||
+                square(series.back().x2, series.back().y2) != squares[count - 1] ||
+                capture != (series[0].xb != -1))
+                continue;
+            bool match = count == 2;
+            if (int(series.size()) == count - 1)
+            {
+                match = true;
+                for (int k = 0; k < int(series.size()); ++k)
+                    match = match && square(series[k].x2, series[k].y2) == squares[k + 1];
+            }
+            if (!match)
+                continue;
+            // Серии, которые отличаются только порядком взятий, ведут в одну позицию
+            if (found && found->final_pos != turn.final_pos)
+                ambiguous = true;
+            if (!found || int(series.size()) == count - 1)
+                found = &turn;
+        }
+        if (!found)
+            throw error("illegal move");
+        if (ambiguous && count == 2 && found->series.size() > 1)
+            throw error("ambiguous capture, give all squares");
+        pos = found->final_pos;
+        game.turns.push_back(*found);
+        color = !color;
+    }
+    return game;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../Models/Move.h"
+#include "../Models/Position.h"
+#include "Logic.h"
+
+// Обдумывание ответов бота, пока ходит человек.
+// Поиск идет в отдельном потоке на копии Logic, которая использует
+// ту же таблицу транспозиций, поэтому даже прерванное обдумывание
+// ускоряет следующий поиск бота. Найденные ответы запоминаются вместе
+// с позицией, и если человек сделал один из обдуманных ходов,
+// бот отвечает сразу, без поиска.
+class Ponder
+{
+  public:
+    // Ответ бота: позиция после хода человека, ход бота в ней
+    // и состояние ГПСЧ бота после поиска этого хода
+    struct Reply
+    {
+        Position pos;
+        vector<move_pos> series;
+        default_random_engine rand_eng;
+    };
+
+    Ponder() = default;
+
+    Ponder(const Ponder &) = delete;
+    Ponder &operator=(const Ponder &) = delete;
+
+    ~Ponder()
+    {
+        stop();
+    }
+
+    // Начинает обдумывание ответов бота уровня depth на ходы
+    // человека цвета color в позиции pos. Ответы прошлого обдумывания забываются.
+    void start(const Logic &logic, const bool color, const Position &pos, const int depth)
+    {
+        stop();
+        replies.clear();
+        bot_color = !color;
+        bot_depth = depth;
+        stop_flag = false;
+        ponder_logic = make_unique<Logic>(logic);
+        ponder_logic->Max_depth = depth;
+        worker = thread([this, color, pos]() {
+            ponder_logic->ponder(color, pos, &stop_flag, [this](const Position &next, vector<move_pos> reply) {
+                replies.push_back({next, std::move(reply), ponder_logic->random_engine()});
+            });
+        });
+    }
+
+    // Останавливает обдумывание и ждет завершения потока
+    void stop()
+    {
+        if (!worker.joinable())
+            return;
+        stop_flag = true;
+        worker.join();
+        ponder_logic.reset();
+    }
+
+    // Обдуманный ответ бота цвета color уровня depth в позиции pos
+    // или nullptr, если такой позиции не было. Вызывается после stop().
+    // Чтобы партия была повторяемой, бот, который использует ответ,
+    // должен взять его состояние ГПСЧ (Logic::set_random_engine).
+    const Reply *find(const bool color, const Position &pos, const int depth) const
+    {
+        if (color != bot_color || depth != bot_depth)
+            return nullptr;
+        for (const auto &reply : replies)
+        {
+            if (reply.pos == pos)
+                return &reply;
+        }
+        return nullptr;
+    }
+
+  private:
+    unique_ptr<Logic> ponder_logic;
+    thread worker;
+    atomic<bool> stop_flag{false};
+    vector<Reply> replies;
+    bool bot_color = false;
+    int bot_depth = -1;
+};
@@ -0,0 +1,137 @@
+#pragma once
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+#include "../Models/Position.h"
+
+// Оценка позиции, если у соперника бота не осталось фигур
+const int INF = 1e9;
+
+// Силы пешек с учетом продвижения: каждая пешка маски men дает 1
+// и 0.05 за каждую пройденную строку (white - пешки белых).
+// Слагаемые прибавляются по одному для каждой пешки по строкам доски,
+// как при переборе клеток в исходной оценке, поэтому результат совпадает
+// с ней бит в бит (сумма продвижений, умноженная на 0.05 один раз,
+// округляется иначе).
+inline double men_with_potential(uint32_t men, const bool white)
+{
+    double res = 0;
+    for (; men; men &= men - 1)
+    {
+        const int row = lowest_bit(men) / 4;
+        res += 1;
+        res += 0.05 * (white ? 7 - row : row);
+    }
+    return res;
+}
+
+// Таблица сил пешек с продвижением. Результат men_with_potential зависит
+// только от количества пешек в каждой строке (пешки строки прибавляются
+// подряд с одинаковыми слагаемыми), но не от суммы продвижений: от порядка
+// строк зависит округление. Поэтому силы пешек берутся из таблицы по номеру,
+// в котором количество пешек в строке (0 - 4) - цифра пятеричной записи.
+// Строка превращения (для белых - строка 0, для черных - 7) в номер не входит:
+// пешки там не стоят, а если стоят (позиция задана вручную), то силы
+// считаются без таблицы. Номер меняется при ходе прибавлением веса строки,
+// поэтому поиск пересчитывает его за O(1) (см. Logic::Eval).
+const int MEN_TABLE_SIZE = 78125; // 5^7
+// Строки превращения пешек: белых и черных
+const uint32_t WHITE_PROMOTION_ROW = 0x0000000F, BLACK_PROMOTION_ROW = 0xF0000000;
+
+// Вес строки row в номере таблицы: у белых 5^(7 - row), у черных 5^row
+inline int men_row_weight(const int row, const bool white)
+{
+    static const int weights[8] = {1, 5, 25, 125, 625, 3125, 15625, 78125};
+    return weights[white ? 7 - row : row];
+}
+
+// Номер таблицы для пешек men (без пешек на строке превращения)
+inline int men_table_index(const uint32_t men, const bool white)
+{
+    int index = 0;
+    for (int row = 0; row < 8; ++row)
+        index += popcount(men & (0xFu << (4 * row))) * men_row_weight(row, white);
+    return index;
+}
+
+struct MenTable
+{
+    std::vector<double> white, black;
+
+    // Каждая строка таблицы считается men_with_potential для пешек,
+    // поставленных на первые клетки строк
+    MenTable() : white(MEN_TABLE_SIZE), black(MEN_TABLE_SIZE)
+    {
+        for (int index = 0; index < MEN_TABLE_SIZE; ++index)
+        {
+            uint32_t w_men = 0, b_men = 0;
+            // Цифра digit номера - строка 7 - digit у белых и строка digit у черных
+            for (int digit = 0, rest = index; digit < 7; ++digit, rest /= 5)
+            {
+                const uint32_t men = (1u << (rest % 5)) - 1;
+                w_men |= men << (4 * (7 - digit));
+                b_men |= men << (4 * digit);
+            }
+            white[index] = men_with_potential(w_men, true);
+            black[index] = men_with_potential(b_men, false);
+        }
+    }
+};
+
+inline const MenTable &men_table()
+{
+    static const MenTable table;
+    return table;
+}
+
+// Силы пешек men с продвижением (то же, что men_with_potential);
+// index - номер таблицы для men
+inline double men_potential(const uint32_t men, const int index, const bool white)
+{
+    if (men & (white ? WHITE_PROMOTION_ROW : BLACK_PROMOTION_ROW))
+        return men_with_potential(men, white);
+    return (white ? men_table().white : men_table().black)[index];
+}
+
+// Оценка позиции для бота по количеству фигур: отношение сил бота
+// (дамка считается за несколько пешек) к силам соперника.
+// w_men, b_men - силы пешек белых и черных: их количество или,
+// в режиме с продвижением, men_potential; w_kings, b_kings - количество дамок.
+// Если first_bot_color == true, то бот черного цвета.
+// potential - учитывать продвижение пешек (режим "NumberAndPotential").
+// Общая для поиска (Logic::calc_score) и пакетной оценки (BatchEval.h),
+// чтобы они давали одинаковый результат.
+inline double score_position(const double w_men, const int w_kings, const double b_men, const int b_kings,
+                             const bool first_bot_color, const bool potential)
+{
+    double w = w_men; // белые пешки
+    double wq = w_kings; // белые дамки
+    double b = b_men; // черные пешки
+    double bq = b_kings; // черные дамки
+
+    // Если бот белого цвета, то поменять местами.
+    if (!first_bot_color)
+    {
+        std::swap(b, w);
+        std::swap(bq, wq);
+    }
+
+    // Если кол-во белых равно нулю, то черные выиграли,
+    // оценка максимальная.
+    if (w + wq == 0)
+        return INF;
+
+    // Если кол-во черных равно нулю, то черные проиграли,
+    // оценка минимальная.
+    if (b + bq == 0)
+        return 0;
+
+    int q_coef = 4; // усиливающий коэффициент для дамки
+    if (potential)
+    {
+        q_coef = 5; // при этой настройке дамка считается сильнее
+    }
+    // Получить оценку в зависимости от соотношения кол-ва фигур
+    return (b + bq * q_coef) / (w + wq * q_coef);
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+// Счетчики одного поиска хода основным потоком (Logic::find_best_turns).
+// Нужны, чтобы сравнивать эффективность поиска между версиями:
+// сколько узлов понадобилось, как часто срабатывает отсечение первым ходом
+// (признак хорошего порядка ходов) и как часто помогает таблица транспозиций.
+// Вспомогательные потоки ведут свои счетчики, в статистику они не входят.
+struct SearchStats
+{
+    // Итерация поиска: глубина, узлы и время с начала итерации
+    struct Iteration
+    {
+        int depth = 0;
+        uint64_t nodes = 0;
+        double ms = 0;
+        // Итерация прервана по времени, ее результат не использован
+        bool stopped = false;
+    };
+
+    // Узлы поиска и статические оценки позиций
+    uint64_t nodes = 0;
+    uint64_t evals = 0;
+    // Отсечения (beta cutoffs) и из них - отсечения первым просмотренным ходом
+    uint64_t cutoffs = 0;
+    uint64_t first_move_cutoffs = 0;
+    // Обращения к таблице транспозиций, найденные записи
+    // и записи, оценка из которых сразу вернулась без поиска
+    uint64_t tt_probes = 0;
+    uint64_t tt_hits = 0;
+    uint64_t tt_cutoffs = 0;
+    // Узлы, оценка которых взята из эндшпильных таблиц
+    uint64_t tb_hits = 0;
+    // Наибольшее количество фигур, побитых одним ходом в поиске
+    int max_capture_chain = 0;
+    // Оценка лучшего хода по последней завершенной итерации для того,
+    // кто ходит (отношение сил, см. score_position; INF - выигрыш, 0 - проигрыш)
+    double score = 0;
+    // Время всего поиска
+    double ms = 0;
+    // Итерации: одна при поиске на глубину уровня, несколько при итеративном углублении
+    std::vector<Iteration> iterations;
+
+    // Глубина последней завершенной итерации (в ходах от корня), 0 - ни одной
+    int completed_depth() const
+    {
+        for (auto it = iterations.rbegin(); it != iterations.rend(); ++it)
+        {
+            if (!it->stopped)
+                return it->depth;
+        }
+        return 0;
+    }
+
+    // Эффективный коэффициент ветвления: сколько узлов в среднем
+    // добавляет каждый ход глубины (корень N-й степени из числа узлов
+    // последней завершенной итерации, N - ее глубина)
+    double branching_factor() const
+    {
+        for (auto it = iterations.rbegin(); it != iterations.rend(); ++it)
+        {
+            if (!it->stopped && it->nodes > 0)
+                return pow(double(it->nodes), 1.0 / it->depth);
+        }
+        return 0;
+    }
+
+    // Одна строка JSON. tt_used - есть ли таблица транспозиций: если нет,
+    // доля попаданий не выводится
+    json to_json(const bool tt_used) const
+    {
+        json res = {{"nodes", nodes},
+                    {"evals", evals},
+                    {"time_ms", round(ms * 1000) / 1000},
+                    {"nps", uint64_t(nodes / std::max(ms, 1e-3) * 1000)},
+                    {"cutoffs", cutoffs},
+                    {"first_move_cutoff_rate", cutoffs ? double(first_move_cutoffs) / cutoffs : 0.0},
+                    {"branching_factor", branching_factor()},
+                    {"max_capture_chain", max_capture_chain},
+                    {"tb_hits", tb_hits},
+                    {"depth", completed_depth()},
+                    {"score", score}};
+        if (tt_used)
+        {
+            res["tt_probes"] = tt_probes;
+            res["tt_hit_rate"] = tt_probes ? double(tt_hits) / tt_probes : 0.0;
+            res["tt_cutoff_rate"] = tt_probes ? double(tt_cutoffs) / tt_probes : 0.0;
+        }
+        json its = json::array();
+        for (const auto &it : iterations)
+        {
+            its.push_back({{"depth", it.depth}, {"nodes", it.nodes}, {"time_ms", round(it.ms * 1000) / 1000}});
+            if (it.stopped)
+                its.back()["stopped"] = true;
+        }
+        res["iterations"] = its;
+        return res;
+    }
+};
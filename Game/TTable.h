@@ -0,0 +1,173 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <memory>
+#include <random>
+
+#include "../Models/Position.h"
+
+// Случайные ключи Зобриста для хэширования позиций.
+// Хэш позиции - это xor ключей всех фигур на доске,
+// поэтому при ходе его можно пересчитать за несколько операций.
+struct Zobrist
+{
+    // Ключ для фигуры заданного типа (1 - 4, как в Board) на клетке
+    uint64_t pieces[5][32];
+    // Ключ, добавляемый если ходят черные
+    uint64_t black_move;
+    // Ключ, добавляемый если бот играет за черных
+    // (от этого зависит оценка позиции)
+    uint64_t black_bot;
+
+    Zobrist()
+    {
+        // Постоянный seed, чтобы хэши совпадали между запусками
+        std::mt19937_64 rnd(20221017);
+        for (int type = 0; type < 5; ++type)
+        {
+            for (int sq = 0; sq < 32; ++sq)
+                pieces[type][sq] = type ? rnd() : 0;
+        }
+        black_move = rnd();
+        black_bot = rnd();
+    }
+};
+
+inline const Zobrist &zobrist()
+{
+    static const Zobrist keys;
+    return keys;
+}
+
+// Хэш расположения фигур (без учета очередности хода)
+inline uint64_t hash_position(const Position &pos)
+{
+    uint64_t hash = 0;
+    for (uint32_t bb = pos.white | pos.black; bb; bb &= bb - 1)
+    {
+        const int sq = lowest_bit(bb);
+        hash ^= zobrist().pieces[pos.get(sq)][sq];
+    }
+    return hash;
+}
+
+// Тип оценки, сохраненной в таблице
+enum class Bound : uint8_t
+{
+    EXACT, // точная оценка
+    LOWER, // оценка снизу (было отсечение в узле максимизации)
+    UPPER  // оценка сверху (было отсечение в узле минимизации)
+};
+
+// Запись таблицы транспозиций
+struct TTEntry
+{
+    // Оценка позиции
+    double score = 0;
+    // Лучший ход: маска побитых фигур, начальная и конечная клетки
+    uint32_t beaten = 0;
+    int8_t from = -1, to = -1;
+    // Оставшаяся глубина, с которой была получена оценка
+    int8_t depth = -1;
+    Bound bound = Bound::EXACT;
+};
+
+// Таблица транспозиций фиксированного размера.
+// Хранит оценки уже просчитанных позиций, чтобы не считать их заново,
+// когда позиция получается другим порядком ходов.
+// Таблица общая для всех потоков поиска и работает без блокировок:
+// запись хранится в трех атомарных словах, а ключ сохраняется
+// в виде xor с данными, поэтому запись, которую другой поток
+// успел переписать только частично, просто не найдется.
+class TTable
+{
+  public:
+    // size_mb - размер таблицы в мегабайтах, 0 - таблица отключена
+    TTable(const size_t size_mb)
+    {
+        // Количество записей округляется вниз до степени двойки
+        const size_t max_entries = size_mb * 1024 * 1024 / sizeof(Slot);
+        size_t entries = 1;
+        while (entries * 2 <= max_entries)
+            entries *= 2;
+        if (max_entries)
+        {
+            table.reset(new Slot[entries]);
+            mask = entries - 1;
+        }
+    }
+
+    TTable(const TTable &) = delete;
+    TTable &operator=(const TTable &) = delete;
+
+    // Таблица отключена (размер 0)
+    bool empty() const
+    {
+        return !table;
+    }
+
+    // Найти запись для позиции и скопировать ее в entry.
+    // Возвращает false, если записи нет.
+    bool probe(const uint64_t key, TTEntry &entry) const
+    {
+        if (!table)
+            return false;
+        const Slot &slot = table[key & mask];
+        const uint64_t score_bits = slot.score.load(std::memory_order_relaxed);
+        const uint64_t data = slot.data.load(std::memory_order_relaxed);
+        if ((slot.key.load(std::memory_order_relaxed) ^ score_bits ^ data) != key)
+            return false;
+        memcpy(&entry.score, &score_bits, sizeof(double));
+        entry.beaten = uint32_t(data);
+        entry.from = int8_t(data >> 32);
+        entry.to = int8_t(data >> 40);
+        entry.depth = int8_t(data >> 48);
+        entry.bound = Bound(data >> 56);
+        return true;
+    }
+
+    // Сохранить оценку позиции.
+    // Запись той же позиции, просчитанная глубже, не затирается.
+    void store(const uint64_t key, const int depth, const Bound bound, const double score, const int8_t from,
+               const int8_t to, const uint32_t beaten)
+    {
+        if (!table)
+            return;
+        TTEntry old;
+        if (probe(key, old) && old.depth > depth)
+            return;
+        uint64_t score_bits;
+        memcpy(&score_bits, &score, sizeof(double));
+        const uint64_t data = uint64_t(beaten) | (uint64_t(uint8_t(from)) << 32) | (uint64_t(uint8_t(to)) << 40) |
+                              (uint64_t(uint8_t(depth)) << 48) | (uint64_t(bound) << 56);
+        Slot &slot = table[key & mask];
+        slot.key.store(key ^ score_bits ^ data, std::memory_order_relaxed);
+        slot.score.store(score_bits, std::memory_order_relaxed);
+        slot.data.store(data, std::memory_order_relaxed);
+    }
+
+    // Очистить таблицу
+    void clear()
+    {
+        for (size_t i = 0; table && i <= mask; ++i)
+        {
+            table[i].key.store(0, std::memory_order_relaxed);
+            table[i].score.store(0, std::memory_order_relaxed);
+            table[i].data.store(0, std::memory_order_relaxed);
+        }
+    }
+
+  private:
+    // Ячейка таблицы: ключ (xor с данными), оценка и упакованные
+    // лучший ход, глубина и тип оценки
+    struct Slot
+    {
+        std::atomic<uint64_t> key{0};
+        std::atomic<uint64_t> score{0};
+        std::atomic<uint64_t> data{0};
+    };
+
+    std::unique_ptr<Slot[]> table;
+    size_t mask = 0;
+};
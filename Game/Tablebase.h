@@ -0,0 +1,340 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../Models/Position.h"
+#include "MappedFile.h"
+
+// Эндшпильные таблицы: для каждой позиции с небольшим числом фигур
+// хранится результат при лучшей игре обеих сторон и число ходов до конца партии.
+// Таблицы строятся утилитой Tools/tbgen.cpp и читаются поиском бота.
+
+// Наибольшее число фигур в таблицах
+const int TB_MAX_PIECES = 8;
+// Число позиций в блоке сжатия
+const uint32_t TB_BLOCK_SIZE = 1024;
+// Наибольшее расстояние до конца партии, которое помещается в таблицу
+const int TB_MAX_DISTANCE = 254;
+
+// Значение позиции в таблице (для стороны, которая ходит):
+// 0 - ничья, иначе расстояние до конца партии в ходах плюс один.
+// При четном расстоянии сторона проигрывает, при нечетном - выигрывает.
+inline bool tb_is_win(const int value)
+{
+    return value && (value - 1) % 2 == 1;
+}
+
+inline bool tb_is_loss(const int value)
+{
+    return value && (value - 1) % 2 == 0;
+}
+
+// Биномиальный коэффициент C(n, k) для n <= 32
+inline uint64_t binomial(const int n, const int k)
+{
+    struct Table
+    {
+        uint64_t c[33][33] = {};
+        Table()
+        {
+            for (int i = 0; i <= 32; ++i)
+            {
+                c[i][0] = 1;
+                for (int j = 1; j <= i; ++j)
+                    c[i][j] = c[i - 1][j - 1] + c[i - 1][j];
+            }
+        }
+    };
+    static const Table table;
+    return k < 0 || k > n ? 0 : table.c[n][k];
+}
+
+// Номер множества клеток среди всех множеств того же размера
+// (колексикографический порядок: s1 < s2 < ... дают C(s1, 1) + C(s2, 2) + ...)
+inline uint64_t subset_rank(uint32_t mask)
+{
+    uint64_t rank = 0;
+    for (int i = 1; mask; mask &= mask - 1, ++i)
+        rank += binomial(lowest_bit(mask), i);
+    return rank;
+}
+
+// Множество из k клеток по его номеру (обратно к subset_rank)
+inline uint32_t subset_unrank(const int k, uint64_t rank)
+{
+    uint32_t mask = 0;
+    for (int i = k; i >= 1; --i)
+    {
+        int c = i - 1;
+        while (binomial(c + 1, i) <= rank)
+            ++c;
+        mask |= 1u << c;
+        rank -= binomial(c, i);
+    }
+    return mask;
+}
+
+// Материал: количество пешек и дамок каждого цвета.
+// Для каждого материала строится отдельная таблица позиций с ходом белых,
+// позиции с ходом черных сводятся к ним поворотом доски (Position::flipped).
+struct Material
+{
+    int white_men = 0, white_kings = 0, black_men = 0, black_kings = 0;
+
+    static Material of(const Position &pos)
+    {
+        Material res;
+        res.white_men = popcount(pos.white & ~pos.kings);
+        res.white_kings = popcount(pos.white & pos.kings);
+        res.black_men = popcount(pos.black & ~pos.kings);
+        res.black_kings = popcount(pos.black & pos.kings);
+        return res;
+    }
+
+    int pieces() const
+    {
+        return white_men + white_kings + black_men + black_kings;
+    }
+
+    int men() const
+    {
+        return white_men + black_men;
+    }
+
+    // Материал после смены цветов
+    Material swapped() const
+    {
+        return {black_men, black_kings, white_men, white_kings};
+    }
+
+    bool operator==(const Material &other) const
+    {
+        return key() == other.key();
+    }
+
+    uint32_t key() const
+    {
+        return uint32_t(white_men) | uint32_t(white_kings) << 8 | uint32_t(black_men) << 16 |
+               uint32_t(black_kings) << 24;
+    }
+
+    // Имя файла таблицы, например "wm1wk2bm0bk1.tb"
+    std::string file_name() const
+    {
+        return "wm" + std::to_string(white_men) + "wk" + std::to_string(white_kings) + "bm" +
+               std::to_string(black_men) + "bk" + std::to_string(black_kings) + ".tb";
+    }
+
+    // Количество номеров позиций: каждая группа фигур нумеруется
+    // независимо, поэтому часть номеров не соответствует позициям
+    uint64_t size() const
+    {
+        return binomial(32, white_men) * binomial(32, white_kings) * binomial(32, black_men) *
+               binomial(32, black_kings);
+    }
+
+    // Номер позиции с этим материалом
+    uint64_t index(const Position &pos) const
+    {
+        uint64_t res = subset_rank(pos.white & ~pos.kings);
+        res = res * binomial(32, white_kings) + subset_rank(pos.white & pos.kings);
+        res = res * binomial(32, black_men) + subset_rank(pos.black & ~pos.kings);
+        return res * binomial(32, black_kings) + subset_rank(pos.black & pos.kings);
+    }
+
+    // Позиция по номеру. Возвращает false, если номер не соответствует
+    // позиции: фигуры стоят на одной клетке или пешка на поле превращения.
+    bool position(uint64_t idx, Position &pos) const
+    {
+        const uint32_t bk = subset_unrank(black_kings, idx % binomial(32, black_kings));
+        idx /= binomial(32, black_kings);
+        const uint32_t bm = subset_unrank(black_men, idx % binomial(32, black_men));
+        idx /= binomial(32, black_men);
+        const uint32_t wk = subset_unrank(white_kings, idx % binomial(32, white_kings));
+        idx /= binomial(32, white_kings);
+        const uint32_t wm = subset_unrank(white_men, idx);
+        if ((wm & TOP_ROW) || (bm & BOTTOM_ROW))
+            return false;
+        if (popcount(wm | wk | bm | bk) != pieces())
+            return false;
+        pos.white = wm | wk;
+        pos.black = bm | bk;
+        pos.kings = wk | bk;
+        return true;
+    }
+};
+
+// Набор эндшпильных таблиц, отображенных в память.
+// Файл таблицы: заголовок, смещения блоков и блоки, сжатые кодированием
+// длин серий (пары "значение, длина серии - 1").
+class Tablebase
+{
+  public:
+    // Загружает все таблицы из каталога dir, которые в нем есть
+    explicit Tablebase(const std::string &dir)
+    {
+        for (int wm = 0; wm <= TB_MAX_PIECES; ++wm)
+            for (int wk = 0; wm + wk <= TB_MAX_PIECES; ++wk)
+                for (int bm = 0; wm + wk + bm <= TB_MAX_PIECES; ++bm)
+                    for (int bk = 0; wm + wk + bm + bk <= TB_MAX_PIECES; ++bk)
+                    {
+                        const Material material{wm, wk, bm, bk};
+                        if (wm + wk == 0 || bm + bk == 0)
+                            continue;
+                        MappedFile file;
+                        if (!file.open(dir + "/" + material.file_name()))
+                            continue;
+                        add(material, std::move(file));
+                    }
+    }
+
+    Tablebase(const Tablebase &) = delete;
+    Tablebase &operator=(const Tablebase &) = delete;
+
+    // Наибольшее число фигур, для которого есть таблицы
+    int max_pieces() const
+    {
+        return max_pieces_;
+    }
+
+    bool empty() const
+    {
+        return tables.empty();
+    }
+
+    // Значение позиции pos с ходом игрока color (см. tb_is_win)
+    // или -1, если таблицы для такого материала нет
+    int probe(Position pos, const bool color) const
+    {
+        if (color)
+            pos = pos.flipped();
+        const Material material = Material::of(pos);
+        const auto it = tables.find(material.key());
+        if (it == tables.end())
+            return -1;
+        return it->second.get(material.index(pos));
+    }
+
+    // Запись таблицы материала material со значениями values в формат файла
+    static std::vector<uint8_t> encode(const Material &material, const std::vector<uint8_t> &values)
+    {
+        const uint64_t blocks = (values.size() + TB_BLOCK_SIZE - 1) / TB_BLOCK_SIZE;
+        std::vector<uint8_t> res(HEADER_SIZE + (blocks + 1) * 8);
+        Header header;
+        memcpy(header.magic, MAGIC, 4);
+        header.version = VERSION;
+        header.material = material.key();
+        header.block_size = TB_BLOCK_SIZE;
+        header.positions = values.size();
+        header.blocks = blocks;
+        memcpy(res.data(), &header, HEADER_SIZE);
+
+        std::vector<uint64_t> offsets;
+        std::vector<uint8_t> data;
+        for (uint64_t block = 0; block < blocks; ++block)
+        {
+            offsets.push_back(data.size());
+            const uint64_t end = std::min<uint64_t>(values.size(), (block + 1) * TB_BLOCK_SIZE);
+            for (uint64_t i = block * TB_BLOCK_SIZE; i < end;)
+            {
+                uint64_t run = 1;
+                while (i + run < end && run < 256 && values[i + run] == values[i])
+                    ++run;
+                data.push_back(values[i]);
+                data.push_back(uint8_t(run - 1));
+                i += run;
+            }
+        }
+        offsets.push_back(data.size());
+        memcpy(res.data() + HEADER_SIZE, offsets.data(), offsets.size() * 8);
+        res.insert(res.end(), data.begin(), data.end());
+        return res;
+    }
+
+  private:
+    static constexpr const char *MAGIC = "CKTB";
+    static const uint32_t VERSION = 1;
+
+    // Заголовок файла
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t material;
+        uint32_t block_size;
+        uint64_t positions;
+        uint64_t blocks;
+    };
+    static const size_t HEADER_SIZE = sizeof(Header);
+
+    // Таблица одного материала
+    struct Table
+    {
+        MappedFile file;
+        const uint8_t *offsets = nullptr;
+        const uint8_t *data = nullptr;
+
+        // Значение позиции с номером idx
+        int get(const uint64_t idx) const
+        {
+            const uint64_t block = idx / TB_BLOCK_SIZE;
+            uint64_t offset, end;
+            memcpy(&offset, offsets + block * 8, 8);
+            memcpy(&end, offsets + block * 8 + 8, 8);
+            uint64_t rest = idx % TB_BLOCK_SIZE;
+            for (; offset < end; offset += 2)
+            {
+                const uint64_t run = uint64_t(data[offset + 1]) + 1;
+                if (rest < run)
+                    return data[offset];
+                rest -= run;
+            }
+            return 0;
+        }
+    };
+
+    // Проверяет заголовок файла и добавляет таблицу
+    void add(const Material &material, MappedFile file)
+    {
+        const std::string name = material.file_name();
+        Header header;
+        if (file.size() < HEADER_SIZE)
+            throw std::runtime_error("tablebase file is too short: " + name);
+        memcpy(&header, file.data(), HEADER_SIZE);
+        const uint64_t blocks = (material.size() + TB_BLOCK_SIZE - 1) / TB_BLOCK_SIZE;
+        if (memcmp(header.magic, MAGIC, 4) || header.version != VERSION || header.material != material.key() ||
+            header.block_size != TB_BLOCK_SIZE || header.positions != material.size() || header.blocks != blocks ||
+            file.size() < HEADER_SIZE + (blocks + 1) * 8)
+            throw std::runtime_error("bad tablebase file: " + name);
+        uint64_t data_size;
+        memcpy(&data_size, file.data() + HEADER_SIZE + blocks * 8, 8);
+        if (data_size > file.size() || file.size() != HEADER_SIZE + (blocks + 1) * 8 + data_size)
+            throw std::runtime_error("bad tablebase file size: " + name);
+        // Блоки должны идти подряд внутри данных и состоять из целых пар,
+        // тогда get не читает за пределами файла
+        uint64_t prev = 0;
+        for (uint64_t block = 0; block <= blocks; ++block)
+        {
+            uint64_t offset;
+            memcpy(&offset, file.data() + HEADER_SIZE + block * 8, 8);
+            if (offset < prev || (offset - prev) % 2 || (block == 0 && offset != 0))
+                throw std::runtime_error("bad tablebase block offsets: " + name);
+            prev = offset;
+        }
+
+        Table table;
+        table.offsets = file.data() + HEADER_SIZE;
+        table.data = table.offsets + (blocks + 1) * 8;
+        table.file = std::move(file);
+        tables.emplace(material.key(), std::move(table));
+        max_pieces_ = std::max(max_pieces_, material.pieces());
+    }
+
+    std::unordered_map<uint32_t, Table> tables;
+    int max_pieces_ = 0;
+};
@@ -0,0 +1,284 @@
+#pragma once
+#include <stdint.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
+#include "Move.h"
+
+// Упакованное представление доски (bitboard).
+// Используются только 32 темные клетки, по 4 в каждой строке.
+// Клетка (x, y) имеет номер x * 4 + y / 2, то есть нумерация идет
+// построчно сверху вниз, как и обход матрицы в Board.
+// В четных строках темные клетки находятся в нечетных столбцах,
+// в нечетных строках - в четных.
+
+// Маски строк с четным и нечетным номером
+const uint32_t EVEN_ROWS = 0x0F0F0F0F;
+const uint32_t ODD_ROWS = 0xF0F0F0F0;
+// Маски крайних клеток строки (первая и последняя четверть строки)
+const uint32_t FIRST_IN_ROW = 0x11111111;
+const uint32_t LAST_IN_ROW = 0x88888888;
+// Маски крайних строк доски
+const uint32_t TOP_ROW = 0x0000000F;
+const uint32_t BOTTOM_ROW = 0xF0000000;
+
+// Направления движения по диагонали.
+// "Вверх" - в сторону уменьшения номера строки (туда ходят белые пешки).
+enum Dir
+{
+    UP_LEFT,
+    UP_RIGHT,
+    DOWN_LEFT,
+    DOWN_RIGHT
+};
+
+// Направление, противоположное заданному
+inline Dir opposite(const Dir dir)
+{
+    return Dir(3 - dir);
+}
+
+// Сдвиг всех клеток маски на одну клетку по диагонали.
+// Клетки, выходящие за край доски, отбрасываются.
+inline uint32_t shift(const uint32_t bb, const Dir dir)
+{
+    switch (dir)
+    {
+    case UP_LEFT:
+        return ((bb & EVEN_ROWS) >> 4) | ((bb & ODD_ROWS & ~FIRST_IN_ROW) >> 5);
+    case UP_RIGHT:
+        return ((bb & EVEN_ROWS & ~LAST_IN_ROW) >> 3) | ((bb & ODD_ROWS) >> 4);
+    case DOWN_LEFT:
+        return ((bb & EVEN_ROWS) << 4) | ((bb & ODD_ROWS & ~FIRST_IN_ROW) << 3);
+    default:
+        return ((bb & EVEN_ROWS & ~LAST_IN_ROW) << 5) | ((bb & ODD_ROWS) << 4);
+    }
+}
+
+// Количество единичных битов
+inline int popcount(const uint32_t bb)
+{
+#ifdef _MSC_VER
+    return int(__popcnt(bb));
+#else
+    return __builtin_popcount(bb);
+#endif
+}
+
+// Номер младшего единичного бита (bb != 0)
+inline int lowest_bit(const uint32_t bb)
+{
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, bb);
+    return int(idx);
+#else
+    return __builtin_ctz(bb);
+#endif
+}
+
+// Обратный порядок битов: клетка sq переходит в клетку 31 - sq,
+// то есть доска поворачивается на 180 градусов
+inline uint32_t reverse_bits(uint32_t bb)
+{
+    bb = ((bb >> 1) & 0x55555555) | ((bb & 0x55555555) << 1);
+    bb = ((bb >> 2) & 0x33333333) | ((bb & 0x33333333) << 2);
+    bb = ((bb >> 4) & 0x0F0F0F0F) | ((bb & 0x0F0F0F0F) << 4);
+    bb = ((bb >> 8) & 0x00FF00FF) | ((bb & 0x00FF00FF) << 8);
+    return (bb >> 16) | (bb << 16);
+}
+
+// Номер клетки по координатам
+inline int square(const POS_T x, const POS_T y)
+{
+    return x * 4 + y / 2;
+}
+
+// Строка клетки
+inline POS_T square_x(const int sq)
+{
+    return POS_T(sq / 4);
+}
+
+// Столбец клетки
+inline POS_T square_y(const int sq)
+{
+    return POS_T(2 * (sq % 4) + 1 - (sq / 4) % 2);
+}
+
+// Название клетки на доске, например "a1"
+inline std::string square_name(const int sq)
+{
+    return {char('a' + square_y(sq)), char('8' - square_x(sq))};
+}
+
+// Позиция на доске: маски белых и черных фигур и маска дамок
+struct Position
+{
+    uint32_t white = 0;
+    uint32_t black = 0;
+    uint32_t kings = 0;
+
+    // Фигуры заданного цвета (false - белые, true - черные)
+    uint32_t pieces(const bool color) const
+    {
+        return color ? black : white;
+    }
+
+    // Свободные клетки
+    uint32_t empty() const
+    {
+        return ~(white | black);
+    }
+
+    // Тип фигуры на клетке в обозначениях Board:
+    // 0 - пусто, 1 - белая пешка, 2 - черная пешка,
+    // 3 - белая дамка, 4 - черная дамка.
+    POS_T get(const int sq) const
+    {
+        const uint32_t bit = 1u << sq;
+        if (!((white | black) & bit))
+            return 0;
+        return POS_T(((black & bit) ? 2 : 1) + ((kings & bit) ? 2 : 0));
+    }
+
+    // Поставить на клетку фигуру заданного типа (0 - очистить клетку)
+    void set(const int sq, const POS_T type)
+    {
+        const uint32_t bit = 1u << sq;
+        white &= ~bit;
+        black &= ~bit;
+        kings &= ~bit;
+        if (!type)
+            return;
+        if (type % 2)
+            white |= bit;
+        else
+            black |= bit;
+        if (type > 2)
+            kings |= bit;
+    }
+
+    // Зеркальная позиция: доска повернута на 180 градусов, а цвета фигур
+    // поменяны местами. Ход белых в ней равносилен ходу черных в исходной.
+    Position flipped() const
+    {
+        Position res;
+        res.white = reverse_bits(black);
+        res.black = reverse_bits(white);
+        res.kings = reverse_bits(kings);
+        return res;
+    }
+
+    bool operator==(const Position &other) const
+    {
+        return white == other.white && black == other.black && kings == other.kings;
+    }
+
+    bool operator!=(const Position &other) const
+    {
+        return !(*this == other);
+    }
+
+    // Построение позиции по записи в формате FEN из PDN, например
+    // "W:Wa3,c3,Kd2:Bb6,h8": первая буква - чей ход (color = true, если черных),
+    // далее списки белых и черных фигур, K перед клеткой означает дамку.
+    // Клетки записываются как на доске: a1 - левый нижний угол со стороны белых.
+    static Position from_fen(const std::string &fen, bool &color)
+    {
+        Position pos;
+        size_t i = 0;
+        // пропустить пробелы и кавычки
+        auto skip = [&]() {
+            while (i < fen.size() && (fen[i] == ' ' || fen[i] == '"'))
+                ++i;
+        };
+        skip();
+        if (i >= fen.size() || (fen[i] != 'W' && fen[i] != 'B'))
+            throw std::runtime_error("FEN must start with side to move: " + fen);
+        color = fen[i++] == 'B';
+        while (i < fen.size() && fen[i] == ':')
+        {
+            ++i;
+            skip();
+            if (i >= fen.size() || (fen[i] != 'W' && fen[i] != 'B'))
+                throw std::runtime_error("FEN piece list must start with W or B: " + fen);
+            const bool is_black = fen[i++] == 'B';
+            while (true)
+            {
+                skip();
+                if (i >= fen.size() || fen[i] == ':' || fen[i] == '.')
+                    break;
+                const bool is_king = fen[i] == 'K';
+                if (is_king)
+                    ++i;
+                if (i + 1 >= fen.size() || fen[i] < 'a' || fen[i] > 'h' || fen[i + 1] < '1' || fen[i + 1] > '8')
+                    throw std::runtime_error("bad square in FEN: " + fen);
+                const POS_T x = POS_T('8' - fen[i + 1]), y = POS_T(fen[i] - 'a');
+                if ((x + y) % 2 == 0)
+                    throw std::runtime_error("light square in FEN: " + fen);
+                pos.set(square(x, y), POS_T((is_black ? 2 : 1) + (is_king ? 2 : 0)));
+                i += 2;
+                if (i < fen.size() && fen[i] == ',')
+                    ++i;
+            }
+        }
+        return pos;
+    }
+
+    // Запись позиции в формате FEN (см. from_fen)
+    std::string to_fen(const bool color) const
+    {
+        std::string res = color ? "B" : "W";
+        for (const bool is_black : {false, true})
+        {
+            res += is_black ? ":B" : ":W";
+            bool first = true;
+            // Клетки перечисляются по горизонталям, начиная с первой
+            for (int x = 7; x >= 0; --x)
+            {
+                for (int sq = x * 4; sq < x * 4 + 4; ++sq)
+                {
+                    if (!(pieces(is_black) & (1u << sq)))
+                        continue;
+                    if (!first)
+                        res += ',';
+                    first = false;
+                    if (kings & (1u << sq))
+                        res += 'K';
+                    res += square_name(sq);
+                }
+            }
+        }
+        return res;
+    }
+
+    // Построение позиции по матрице доски из Board
+    static Position from_matrix(const std::vector<std::vector<POS_T>> &mtx)
+    {
+        Position pos;
+        for (POS_T i = 0; i < 8; ++i)
+        {
+            for (POS_T j = 0; j < 8; ++j)
+            {
+                if ((i + j) % 2 == 1 && mtx[i][j])
+                    pos.set(square(i, j), mtx[i][j]);
+            }
+        }
+        return pos;
+    }
+
+    // Преобразование позиции в матрицу доски
+    std::vector<std::vector<POS_T>> to_matrix() const
+    {
+        std::vector<std::vector<POS_T>> mtx(8, std::vector<POS_T>(8, 0));
+        for (int sq = 0; sq < 32; ++sq)
+            mtx[square_x(sq)][square_y(sq)] = get(sq);
+        return mtx;
+    }
+};
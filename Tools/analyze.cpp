@@ -0,0 +1,361 @@
+// Анализ партий и позиций без окна: оценка и лучший ход бота
+// (Logic::find_best_turns) для каждой позиции.
+// Вход - архив партий PDN (файл *.pdn, см. Game/Pdn.h): анализируется каждая
+// позиция каждой партии, в которой есть ход, в порядке партий и ходов.
+// Иначе вход - список позиций, по одной в строке: FEN и необязательные
+// ограничения этой позиции "level=N" (уровень бота) и "time=MS" (время в мс),
+// например "W:Wc3,e3:Bb4,d6 level=10". Пустые строки и строки с # пропускаются.
+// Позиции распределяются между потоками, у каждого потока свой бот (своя
+// таблица транспозиций), а результаты пишутся в выходной файл строками JSON
+// в том порядке, в котором позиции прочитаны. Каждая строка дописывается
+// сразу, поэтому прерванный анализ продолжается повторным запуском
+// с тем же выходным файлом: готовые позиции пропускаются, а недописанная
+// последняя строка отрезается.
+//
+// Запуск из корня проекта (настройки бота читаются из settings.json):
+//     analyze [вход] [выход] [уровень] [время в мс] [количество потоков]
+// По умолчанию вход - файл из настройки PdnFile, выход analysis.jsonl,
+// уровень 6, время 0 (поиск на глубину уровня), все ядра.
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Game/Config.h"
+#include "../Game/Logic.h"
+#include "../Game/Pdn.h"
+
+// Позиция для анализа
+struct Task
+{
+    // Номер позиции во входе (и строки результата в выходном файле)
+    uint64_t index = 0;
+    Position pos;
+    bool color = false;
+    // Ограничения поиска
+    int level = 0;
+    unsigned int time_ms = 0;
+    // Откуда позиция: партия и ход в ней или строка списка позиций
+    json source;
+};
+
+// Позиции из архива PDN: все позиции партии до каждого ее хода
+class PdnSource
+{
+  public:
+    PdnSource(const string &path, Config *config, const int level, const unsigned int time_ms)
+        : logic(config), level(level), time_ms(time_ms)
+    {
+        if (!reader.open(path))
+            throw runtime_error("can't open " + path);
+    }
+
+    // Следующая позиция; false - позиций больше нет
+    bool next(Task &task)
+    {
+        while (ply >= game.turns.size())
+        {
+            if (!next_game())
+                return false;
+        }
+        task.pos = ply ? game.turns[ply - 1].final_pos : game.start;
+        task.color = game.start_color != (ply % 2 == 1);
+        task.level = level;
+        task.time_ms = time_ms;
+        task.source = {{"game", game_num}, {"offset", offset}, {"ply", ply}};
+        ++ply;
+        return true;
+    }
+
+    // Партии с ошибками (они пропускаются целиком)
+    uint64_t errors = 0;
+
+  private:
+    bool next_game()
+    {
+        PdnRecord record;
+        while (true)
+        {
+            try
+            {
+                if (!reader.next(record))
+                    return false;
+                ++game_num;
+                offset = record.offset;
+                game = replay_pdn(record, logic);
+                ply = 0;
+                return true;
+            }
+            catch (const exception &e)
+            {
+                cerr << e.what() << "\n";
+                ++errors;
+            }
+        }
+    }
+
+    PdnReader reader;
+    Logic logic;
+    const int level;
+    const unsigned int time_ms;
+    PdnGame game;
+    int64_t game_num = -1;
+    size_t offset = 0;
+    size_t ply = 0;
+};
+
+// Позиции из списка: FEN и ограничения поиска в строке
+class FenSource
+{
+  public:
+    FenSource(const string &path, const int level, const unsigned int time_ms)
+        : fin(path), level(level), time_ms(time_ms)
+    {
+        if (!fin)
+            throw runtime_error("can't open " + path);
+    }
+
+    bool next(Task &task)
+    {
+        string line;
+        while (getline(fin, line))
+        {
+            ++line_num;
+            istringstream words(line);
+            string fen, word;
+            if (!(words >> fen) || fen[0] == '#')
+                continue;
+            task.level = level;
+            task.time_ms = time_ms;
+            try
+            {
+                task.pos = Position::from_fen(fen, task.color);
+                while (words >> word)
+                {
+                    const size_t eq = word.find('=');
+                    const string name = word.substr(0, eq), value = eq == string::npos ? "" : word.substr(eq + 1);
+                    if (value.empty() || value.size() > 9 || value.find_first_not_of("0123456789") != string::npos)
+                        throw runtime_error("bad limit " + word);
+                    if (name == "level" && stoi(value) <= MAX_DEPTH)
+                        task.level = stoi(value);
+                    else if (name == "time")
+                        task.time_ms = stoul(value);
+                    else
+                        throw runtime_error("bad limit " + word);
+                }
+            }
+            catch (const exception &e)
+            {
+                cerr << "line " << line_num << ": " << e.what() << "\n";
+                ++errors;
+                continue;
+            }
+            task.source = {{"line", line_num}};
+            return true;
+        }
+        return false;
+    }
+
+    uint64_t errors = 0;
+
+  private:
+    ifstream fin;
+    const int level;
+    const unsigned int time_ms;
+    int64_t line_num = 0;
+};
+
+// Сколько результатов уже записано в файл path (полных строк).
+// Недописанная последняя строка отрезается.
+uint64_t finished_results(const string &path)
+{
+    ifstream fin(path, ios::binary);
+    if (!fin)
+        return 0;
+    uint64_t lines = 0, size = 0, complete = 0;
+    char buf[1 << 16];
+    while (fin.read(buf, sizeof(buf)) || fin.gcount())
+    {
+        for (streamsize i = 0; i < fin.gcount(); ++i)
+        {
+            if (buf[i] == '\n')
+            {
+                ++lines;
+                complete = size + i + 1;
+            }
+        }
+        size += fin.gcount();
+    }
+    fin.close();
+    if (complete < size)
+        filesystem::resize_file(path, complete);
+    return lines;
+}
+
+// Результат анализа позиции: строка JSON
+string analyze(Logic &logic, const Task &task)
+{
+    logic.Max_depth = task.level;
+    logic.set_time_limit(task.time_ms);
+    // Выбор из равных ходов зависит только от позиции, а не от того,
+    // какие позиции этот поток анализировал до нее
+    logic.seed(unsigned(task.index));
+    const vector<move_pos> best = logic.find_best_turns(task.color, task.pos);
+    json res = {{"index", task.index}, {"fen", task.pos.to_fen(task.color)}};
+    res.update(task.source);
+    if (best.empty())
+    {
+        // Ходов нет - проигрыш того, кто ходит
+        res["best"] = nullptr;
+        res["score"] = 0;
+    }
+    else
+    {
+        res["best"] = pdn_move(best);
+        // Единственный ход при поиске по времени не ищется, оценки нет
+        if (logic.stats.iterations.empty())
+            res["score"] = nullptr;
+        else
+            res["score"] = logic.stats.score;
+    }
+    res["depth"] = logic.stats.completed_depth();
+    res["nodes"] = logic.stats.nodes;
+    res["time_ms"] = round(logic.stats.ms * 1000) / 1000;
+    return res.dump();
+}
+
+int main(int argc, char *argv[])
+{
+    Config config;
+    // Один поток поиска на позицию: параллельно анализируются позиции.
+    // Дебютная книга не используется: ход из нее не дает оценки.
+    config.set("Bot", "Threads", 1);
+    config.set("Bot", "OpeningBook", "");
+    config.set("Bot", "NoRandom", true);
+
+    const string input = argc > 1 ? string(argv[1]) : project_path + string(config("Game", "PdnFile"));
+    const string output = argc > 2 ? string(argv[2]) : "analysis.jsonl";
+    const int level = argc > 3 ? stoi(argv[3]) : 6;
+    const unsigned int time_ms = argc > 4 ? stoul(argv[4]) : 0;
+    const int threads = argc > 5 ? stoi(argv[5]) : max(1, int(thread::hardware_concurrency()));
+    if (level < 0 || level > MAX_DEPTH || threads < 1)
+    {
+        cerr << "usage: analyze [input] [output] [level] [time ms] [threads]\n";
+        return 1;
+    }
+
+    const bool is_pdn = input.size() >= 4 && input.substr(input.size() - 4) == ".pdn";
+    unique_ptr<PdnSource> pdn_source;
+    unique_ptr<FenSource> fen_source;
+    try
+    {
+        if (is_pdn)
+            pdn_source = make_unique<PdnSource>(input, &config, level, time_ms);
+        else
+            fen_source = make_unique<FenSource>(input, level, time_ms);
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+    auto next_task = [&](Task &task) { return is_pdn ? pdn_source->next(task) : fen_source->next(task); };
+
+    const uint64_t skip = finished_results(output);
+    FILE *out = fopen(output.c_str(), "a");
+    if (!out)
+    {
+        cerr << "can't write " << output << "\n";
+        return 1;
+    }
+    if (skip)
+        cerr << "resuming after " << skip << " positions\n";
+
+    // Очередь позиций и готовые результаты, которые ждут записи по порядку.
+    // Позиция не читается, пока она дальше window от первой незаписанной,
+    // поэтому долгий поиск одной позиции не копит результаты в памяти.
+    const uint64_t window = uint64_t(threads) * 16;
+    mutex m;
+    condition_variable cv;
+    deque<Task> queue;
+    map<uint64_t, string> ready;
+    uint64_t next_write = skip;
+    bool done = false;
+
+    const auto start = chrono::steady_clock::now();
+    vector<thread> pool;
+    for (int i = 0; i < threads; ++i)
+    {
+        pool.emplace_back([&]() {
+            Logic logic(&config);
+            unique_lock<mutex> lock(m);
+            while (true)
+            {
+                cv.wait(lock, [&]() { return done || !queue.empty(); });
+                if (queue.empty())
+                    return;
+                const Task task = std::move(queue.front());
+                queue.pop_front();
+                lock.unlock();
+                string line = analyze(logic, task);
+                lock.lock();
+                ready[task.index] = std::move(line);
+                // Записать результаты, готовые по порядку
+                bool written = false;
+                while (!ready.empty() && ready.begin()->first == next_write)
+                {
+                    fputs(ready.begin()->second.c_str(), out);
+                    fputc('\n', out);
+                    ready.erase(ready.begin());
+                    ++next_write;
+                    written = true;
+                }
+                if (written)
+                {
+                    fflush(out);
+                    cv.notify_all();
+                }
+            }
+        });
+    }
+
+    Task task;
+    uint64_t index = 0;
+    while (next_task(task))
+    {
+        task.index = index++;
+        if (task.index < skip)
+            continue;
+        unique_lock<mutex> lock(m);
+        cv.wait(lock, [&]() { return task.index < next_write + window; });
+        queue.push_back(std::move(task));
+        cv.notify_all();
+    }
+    {
+        lock_guard<mutex> lock(m);
+        done = true;
+    }
+    cv.notify_all();
+    for (auto &th : pool)
+        th.join();
+    fclose(out);
+
+    const double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    const uint64_t analyzed = next_write - skip;
+    const uint64_t errors = is_pdn ? pdn_source->errors : fen_source->errors;
+    cout << analyzed << " positions analyzed (" << skip << " done before), " << errors << " input errors, "
+         << (int)ms << " ms, " << analyzed / max(ms, 1.0) * 1000 << " positions/sec\n";
+    return errors ? 1 : 0;
+}
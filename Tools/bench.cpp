@@ -0,0 +1,171 @@
+// Бенчмарк поиска бота без графического интерфейса.
+// Для каждой позиции из стандартного набора выполняется поиск
+// на фиксированную глубину и выводится число узлов, время
+// и количество выделений памяти во время поиска.
+// Если задан файл статистики, то в него дописывается статистика поиска
+// каждой позиции строкой JSON (как в журнале SearchLog), чтобы сравнивать
+// эффективность поиска между версиями.
+// В одном потоке каждая позиция ищется еще раз без таблицы транспозиций:
+// таблица не должна менять оценку и выбранный ход, иначе выводится
+// TT MISMATCH (несколько потоков ищут недетерминированно и не проверяются).
+//
+// Запуск из корня проекта (настройки читаются из settings.json):
+//     bench [глубина] [количество потоков] [файл статистики]
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../Game/Config.h"
+#include "../Game/Logic.h"
+
+// Счетчик выделений памяти: глобальные operator new заменяются на
+// версии, которые считают вызовы. Поиск не должен выделять память
+// в каждом узле, поэтому число выделений не должно расти с глубиной.
+atomic<uint64_t> allocations(0);
+
+// Заменяются все формы new и delete (обычные и для массивов, delete
+// с размером), чтобы память всегда освобождалась парной функцией.
+// Функции не встраиваются: иначе GCC видит внутри них malloc и free
+// и сопоставляет их с new и delete в месте вызова (-Wmismatched-new-delete).
+#if defined(__GNUC__) || defined(__clang__)
+    #define BENCH_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+    #define BENCH_NOINLINE __declspec(noinline)
+#else
+    #define BENCH_NOINLINE
+#endif
+
+BENCH_NOINLINE void *operator new(size_t size)
+{
+    ++allocations;
+    if (void *ptr = malloc(size ? size : 1))
+        return ptr;
+    throw bad_alloc();
+}
+
+BENCH_NOINLINE void *operator new[](size_t size)
+{
+    ++allocations;
+    if (void *ptr = malloc(size ? size : 1))
+        return ptr;
+    throw bad_alloc();
+}
+
+BENCH_NOINLINE void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+BENCH_NOINLINE void operator delete[](void *ptr) noexcept
+{
+    free(ptr);
+}
+
+BENCH_NOINLINE void operator delete(void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+BENCH_NOINLINE void operator delete[](void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+// Стандартный набор позиций: начальная, дебюты, миттельшпиль и эндшпили с дамками
+const vector<string> bench_positions = {
+    "W:Wa1,c1,e1,g1,b2,d2,f2,h2,a3,c3,e3,g3:Bb6,d6,f6,h6,a7,c7,e7,g7,b8,d8,f8,h8",
+    "B:Wa1,c1,g1,b2,d2,h2,a3,c3,e3,g3,f4:Ba5,e5,b6,d6,h6,a7,e7,g7,b8,d8,h8",
+    "W:Wa1,c1,e1,g1,b2,f2,h2,a3,c3,b4:Be3,g5,b6,d6,h6,a7,g7,b8,d8,f8,h8",
+    "W:Wc1,e1,g1,b2,d2,f2,h2,c3,e3,g3,b4:Ba5,e5,d6,f6,h6,a7,c7,e7,b8,f8,h8",
+    "B:Wa1,c1,e1,g1,b2,d2,h2,a3,h4:Bh6,e7,b8,d8,f8,h8",
+    "W:Wa1,c1,e1,g1,b2,d2,a3,g3:Bb6,d6,f6,h6,a7,e7,b8,f8",
+    "B:Wa1,b2,a3,b4,g7,Kf8:Bd6,a7,b8,d8,h8",
+    "W:Wa1,e1,b2,h2,e3,h4,d6,Kc7:Bb6,g7,h8",
+    "W:WKa1,Kh2,c3:BKb8,Kh6,e7",
+    "B:WKc1,Ke3,g1:BKb8,Kg7,a5",
+};
+
+int main(int argc, char *argv[])
+{
+    const int depth = argc > 1 ? stoi(argv[1]) : 6;
+
+    Config config;
+    // Поиск на фиксированную глубину с повторяемым результатом
+    config.set("Bot", "BotTimeLimitMS", 0);
+    config.set("Bot", "NoRandom", true);
+    // Измеряется поиск, поэтому дебютная книга не используется
+    config.set("Bot", "OpeningBook", "");
+    if (argc > 2)
+        config.set("Bot", "Threads", stoi(argv[2]));
+    ofstream stats_out;
+    if (argc > 3)
+        stats_out.open(argv[3], ios_base::app);
+
+    cout << "depth " << depth << ", threads " << config("Bot", "Threads") << ", scoring " << config("Bot", "BotScoringType") << ", optimization "
+         << config("Bot", "Optimization") << "\n";
+    // Те же настройки без таблицы транспозиций для проверки
+    Config no_tt_config = config;
+    no_tt_config.set("Bot", "TTSizeMB", 0);
+    const bool check_tt = int(config("Bot", "Threads")) <= 1 && int(config("Bot", "TTSizeMB")) > 0;
+    uint64_t total_nodes = 0, total_allocations = 0, tt_mismatches = 0;
+    double total_ms = 0;
+    for (const auto &fen : bench_positions)
+    {
+        bool color;
+        const Position pos = Position::from_fen(fen, color);
+        // Новый бот для каждой позиции, чтобы таблица транспозиций была пустой
+        Logic logic(&config);
+        logic.Max_depth = depth;
+
+        const uint64_t allocations_before = allocations;
+        auto start = chrono::steady_clock::now();
+        auto turns = logic.find_best_turns(color, pos);
+        auto end = chrono::steady_clock::now();
+        const uint64_t search_allocations = allocations - allocations_before;
+
+        const double ms = chrono::duration<double, milli>(end - start).count();
+        cout << fen << "\n    nodes " << logic.nodes << ", " << (int)ms << " ms, best "
+             << square_name(square(turns.front().x, turns.front().y)) << "-"
+             << square_name(square(turns.back().x2, turns.back().y2)) << ", allocations " << search_allocations
+             << "\n";
+        if (stats_out.is_open())
+        {
+            json line = {{"fen", fen},
+                         {"level", depth},
+                         {"scoring", config("Bot", "BotScoringType")},
+                         {"optimization", config("Bot", "Optimization")},
+                         {"threads", config("Bot", "Threads")}};
+            line.update(logic.stats_json());
+            stats_out << line.dump() << "\n";
+        }
+        if (check_tt)
+        {
+            Logic no_tt_logic(&no_tt_config);
+            no_tt_logic.Max_depth = depth;
+            const auto no_tt_turns = no_tt_logic.find_best_turns(color, pos);
+            const double score = logic.stats_json()["score"], no_tt_score = no_tt_logic.stats_json()["score"];
+            if (score != no_tt_score || turns != no_tt_turns)
+            {
+                ++tt_mismatches;
+                cout << "    TT MISMATCH: score " << score << ", without table " << no_tt_score << ", best "
+                     << square_name(square(no_tt_turns.front().x, no_tt_turns.front().y)) << "-"
+                     << square_name(square(no_tt_turns.back().x2, no_tt_turns.back().y2)) << "\n";
+            }
+        }
+        total_nodes += logic.nodes;
+        total_allocations += search_allocations;
+        total_ms += ms;
+    }
+    cout << "total nodes " << total_nodes << ", " << (int)total_ms << " ms, "
+         << (uint64_t)(total_nodes / max(total_ms, 1.0) * 1000) << " nodes/sec, " << total_allocations
+         << " allocations\n";
+    if (check_tt)
+        cout << (tt_mismatches ? to_string(tt_mismatches) + " TT MISMATCHES" : "TT matches search without table")
+             << "\n";
+    return tt_mismatches ? 1 : 0;
+}
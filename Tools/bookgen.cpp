@@ -0,0 +1,156 @@
+// Построение дебютной книги по партиям бота с самим собой.
+// Бот играет партии из начальной позиции с поиском на заданную глубину;
+// чтобы партии различались, в дебюте иногда делается случайный ход.
+// Ходы, найденные поиском в первых ходах партии, записываются в книгу.
+// Вес хода - сумма очков стороны, которая его сделала (2 за победу, 1 за ничью),
+// поэтому ходы, которые чаще ведут к победе, выбираются чаще.
+//
+// Запуск из корня проекта (настройки читаются из settings.json):
+//     bookgen [партий] [глубина] [ходов в книге] [количество потоков] [файл]
+// По умолчанию 200 партий, глубина 6, 16 ходов (по 8 на каждую сторону),
+// все ядра, файл из настройки OpeningBook.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "../Game/Config.h"
+#include "../Game/Logic.h"
+
+// Доля случайных ходов в дебюте
+const double RANDOM_TURN_RATE = 0.15;
+
+// Ход партии, который попадет в книгу
+struct PlayedTurn
+{
+    BookMove move;
+    bool color;
+};
+
+int main(int argc, char *argv[])
+{
+    const int games = argc > 1 ? stoi(argv[1]) : 200;
+    const int depth = argc > 2 ? stoi(argv[2]) : 6;
+    const int book_plies = argc > 3 ? stoi(argv[3]) : 16;
+    const int threads = argc > 4 ? stoi(argv[4]) : max(1, int(thread::hardware_concurrency()));
+    Config config;
+    const string path = argc > 5 ? string(argv[5]) : project_path + string(config("Bot", "OpeningBook"));
+    const int max_plies = config("Game", "MaxNumTurns");
+
+    // Поиск на фиксированную глубину без старой книги
+    config.set("Bot", "BotTimeLimitMS", 0);
+    config.set("Bot", "NoRandom", true);
+    config.set("Bot", "Threads", 1);
+    config.set("Bot", "OpeningBook", "");
+
+    cout << games << " games, depth " << depth << ", " << book_plies << " plies in book, " << threads
+         << " threads\n";
+
+    // Ход (ключ позиции, побитые, начало, конец) -> сумма очков
+    map<tuple<uint64_t, uint32_t, int8_t, int8_t>, uint32_t> points;
+    mutex points_mutex;
+    atomic<int> next_game(0);
+    int results[3] = {0, 0, 0}; // победы белых, черных, ничьи
+    const auto start = chrono::steady_clock::now();
+
+    auto worker = [&]() {
+        for (int game = next_game++; game < games; game = next_game++)
+        {
+            mt19937 rnd(game);
+            Logic logic(&config);
+            logic.Max_depth = depth;
+            bool color;
+            Position pos = Position::from_fen(
+                "W:Wa1,c1,e1,g1,b2,d2,f2,h2,a3,c3,e3,g3:Bb6,d6,f6,h6,a7,c7,e7,g7,b8,d8,f8,h8", color);
+            vector<PlayedTurn> played;
+            int winner = 2; // 0 - белые, 1 - черные, 2 - ничья
+            TurnList list;
+            for (int ply = 0; ply < max_plies; ++ply)
+            {
+                logic.generate_turns(color, pos, list);
+                if (!list.size)
+                {
+                    winner = !color;
+                    break;
+                }
+                int chosen = -1;
+                if (ply < book_plies && list.size > 1 && uniform_real_distribution<double>(0, 1)(rnd) < RANDOM_TURN_RATE)
+                    chosen = int(rnd() % list.size);
+                else
+                {
+                    // Найти среди ходов списка ход, выбранный поиском
+                    const vector<move_pos> series = logic.find_best_turns(color, pos);
+                    uint32_t beaten = 0;
+                    for (const auto &move : series)
+                    {
+                        if (move.xb != -1)
+                            beaten |= 1u << square(move.xb, move.yb);
+                    }
+                    const int from = square(series.front().x, series.front().y);
+                    const int to = square(series.back().x2, series.back().y2);
+                    for (int i = 0; i < list.size; ++i)
+                    {
+                        if (list.turns[i].from == from && list.turns[i].to == to && list.turns[i].beaten == beaten)
+                            chosen = i;
+                    }
+                    if (ply < book_plies)
+                    {
+                        BookMove move;
+                        move.key = book_key(pos, color);
+                        move.beaten = beaten;
+                        move.from = int8_t(from);
+                        move.to = int8_t(to);
+                        played.push_back({move, color});
+                    }
+                }
+                list.turns[chosen].apply(pos, color);
+                color = !color;
+            }
+
+            lock_guard<mutex> lock(points_mutex);
+            ++results[winner];
+            for (const auto &turn : played)
+            {
+                const BookMove &move = turn.move;
+                points[{move.key, move.beaten, move.from, move.to}] += winner == 2 ? 1 : (winner == turn.color) * 2;
+            }
+        }
+    };
+    vector<thread> pool;
+    for (int i = 0; i < threads; ++i)
+        pool.emplace_back(worker);
+    for (auto &th : pool)
+        th.join();
+
+    // Ходы, которые ни разу не принесли очков, в книгу не попадают
+    vector<BookMove> book_moves;
+    for (const auto &entry : points)
+    {
+        if (!entry.second)
+            continue;
+        BookMove move;
+        tie(move.key, move.beaten, move.from, move.to) = entry.first;
+        move.weight = uint16_t(min<uint32_t>(entry.second, UINT16_MAX));
+        book_moves.push_back(move);
+    }
+    const auto data = Book::encode(book_moves);
+    ofstream fout(path, ios::binary);
+    fout.write(reinterpret_cast<const char *>(data.data()), streamsize(data.size()));
+    if (!fout)
+    {
+        cerr << "cannot write " << path << "\n";
+        return 1;
+    }
+    cout << "white " << results[0] << ", black " << results[1] << ", draws " << results[2] << "\n";
+    cout << book_moves.size() << " moves, " << data.size() << " bytes, "
+         << (int)chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s\n";
+    return 0;
+}
@@ -0,0 +1,145 @@
+// Проверка и замер пакетной оценки позиций (Game/BatchEval.h).
+// Позиции набираются из случайных партий. Для каждого режима оценки и цвета
+// бота статическая оценка поиска (Logic::static_score) сравнивается бит в бит
+// с исходной оценкой по матрице доски (original_score), а ядра всех доступных
+// наборов команд - со статической оценкой, затем замеряется скорость каждого ядра.
+//
+// Запуск из корня проекта (настройки читаются из settings.json):
+//     evalbench [количество позиций] [повторов замера]
+// По умолчанию 1000000 позиций и 20 повторов.
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../Game/BatchEval.h"
+#include "../Game/Config.h"
+#include "../Game/Logic.h"
+
+// Исходная оценка Logic::calc_score по матрице доски: перебор клеток
+// с подсчетом фигур и продвижения пешек
+double original_score(const vector<vector<POS_T>> &mtx, const bool first_bot_color, const string &scoring_mode)
+{
+    double w = 0, wq = 0, b = 0, bq = 0;
+    for (POS_T i = 0; i < 8; ++i)
+    {
+        for (POS_T j = 0; j < 8; ++j)
+        {
+            w += (mtx[i][j] == 1);
+            wq += (mtx[i][j] == 3);
+            b += (mtx[i][j] == 2);
+            bq += (mtx[i][j] == 4);
+            if (scoring_mode == "NumberAndPotential")
+            {
+                w += 0.05 * (mtx[i][j] == 1) * (7 - i);
+                b += 0.05 * (mtx[i][j] == 2) * (i);
+            }
+        }
+    }
+    if (!first_bot_color)
+    {
+        swap(b, w);
+        swap(bq, wq);
+    }
+    if (w + wq == 0)
+        return INF;
+    if (b + bq == 0)
+        return 0;
+    int q_coef = 4;
+    if (scoring_mode == "NumberAndPotential")
+        q_coef = 5;
+    return (b + bq * q_coef) / (w + wq * q_coef);
+}
+
+// Набирает count позиций из случайных партий
+PositionBatch random_positions(Logic &logic, const size_t count)
+{
+    PositionBatch batch;
+    mt19937 rnd(1);
+    while (batch.size() < count)
+    {
+        bool color;
+        Position pos = Position::from_fen(
+            "W:Wa1,c1,e1,g1,b2,d2,f2,h2,a3,c3,e3,g3:Bb6,d6,f6,h6,a7,c7,e7,g7,b8,d8,f8,h8", color);
+        while (batch.size() < count)
+        {
+            const vector<Turn> turns = logic.find_series(color, pos);
+            if (turns.empty())
+                break;
+            pos = turns[rnd() % turns.size()].final_pos;
+            color = !color;
+            batch.add(pos);
+        }
+    }
+    return batch;
+}
+
+int main(int argc, char *argv[])
+{
+    const size_t count = argc > 1 ? stoul(argv[1]) : 1000000;
+    const int repeats = argc > 2 ? stoi(argv[2]) : 20;
+
+    Config config;
+    config.set("Bot", "TTSizeMB", 0);
+    config.set("Bot", "TablebasePath", "");
+    config.set("Bot", "OpeningBook", "");
+    Logic generator(&config);
+    const PositionBatch batch = random_positions(generator, count);
+
+    vector<SimdLevel> levels;
+    for (const SimdLevel level : {SimdLevel::SCALAR, SimdLevel::SSSE3, SimdLevel::AVX2})
+    {
+        if (level <= simd_level())
+            levels.push_back(level);
+    }
+    cout << count << " positions, CPU supports " << simd_name(simd_level()) << "\n";
+
+    bool all_ok = true;
+    vector<double> expected(count), scores(count);
+    for (const string scoring : {"NumberOnly", "NumberAndPotential"})
+    {
+        Config mode_config = config;
+        mode_config.set("Bot", "BotScoringType", scoring);
+        Logic logic(&mode_config);
+        const bool potential = scoring == "NumberAndPotential";
+        for (const bool bot_color : {false, true})
+        {
+            size_t original_mismatches = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                const Position pos{batch.white[i], batch.black[i], batch.kings[i]};
+                expected[i] = logic.static_score(pos, bot_color);
+                const double original = original_score(pos.to_matrix(), bot_color, scoring);
+                original_mismatches += memcmp(&original, &expected[i], sizeof(double)) != 0;
+            }
+            all_ok = all_ok && original_mismatches == 0;
+            cout << scoring << ", bot " << (bot_color ? "black" : "white") << ":";
+            if (original_mismatches)
+                cout << " " << original_mismatches << " ORIGINAL MISMATCHES";
+            for (const SimdLevel level : levels)
+            {
+                evaluate_batch(batch, bot_color, potential, scores.data(), level);
+                const bool ok = memcmp(scores.data(), expected.data(), count * sizeof(double)) == 0;
+                all_ok = all_ok && ok;
+
+                double best_ms = 1e18;
+                for (int r = 0; r < repeats; ++r)
+                {
+                    const auto start = chrono::steady_clock::now();
+                    evaluate_batch(batch, bot_color, potential, scores.data(), level);
+                    best_ms = min(best_ms, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+                }
+                cout << " " << simd_name(level) << " " << fixed << setprecision(1) << count / best_ms / 1000
+                     << " M/s" << (ok ? "" : " MISMATCH");
+            }
+            cout << "\n";
+        }
+    }
+    cout << (all_ok ? "static_score matches original calc_score, all kernels match static_score" : "MISMATCH")
+         << "\n";
+    return all_ok ? 0 : 1;
+}
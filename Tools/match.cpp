@@ -0,0 +1,254 @@
+// Матч двух настроек бота без графического интерфейса.
+// Партии играются параллельно на всех ядрах без задержек BotDelayMS.
+// Каждая партия начинается несколькими случайными ходами, и каждое такое
+// начало играется дважды со сменой цветов, чтобы случайность дебюта
+// не давала преимущества одной из настроек.
+// Результат выводится для настройки A: победы, ничьи, поражения, разница
+// в рейтинге Эло с 95% доверительным интервалом и статистика SPRT
+// (последовательного теста отношения вероятностей). Матч останавливается
+// досрочно, когда SPRT принимает одну из гипотез: разница не больше elo0
+// или не меньше elo1.
+//
+// Запуск из корня проекта (настройки читаются из settings.json):
+//     match [партий] [количество потоков] [настройка A] [настройка B] [случайных ходов] [elo0] [elo1]
+// Настройка - JSON с параметрами из раздела Bot, которые отличаются от
+// settings.json, и уровнем бота "Level", например '{"Optimization": "O2", "Level": 8}'.
+// По умолчанию 1000 партий, все ядра, уровень 6, 4 случайных хода, elo0 = 0, elo1 = 10.
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Game/Config.h"
+#include "../Game/Logic.h"
+
+// Уровень бота по умолчанию
+const int DEFAULT_LEVEL = 6;
+// Вероятности ошибок SPRT первого и второго рода
+const double SPRT_ALPHA = 0.05, SPRT_BETA = 0.05;
+
+// Настройка бота в матче
+struct Engine
+{
+    Config config;
+    int level = DEFAULT_LEVEL;
+    // Суммарное число узлов и время поиска
+    atomic<uint64_t> nodes{0};
+    atomic<uint64_t> search_us{0};
+};
+
+// Доля очков по разнице в рейтинге Эло и обратно
+double elo_to_score(const double elo)
+{
+    return 1 / (1 + pow(10, -elo / 400));
+}
+
+double score_to_elo(const double score)
+{
+    const double s = min(max(score, 1e-6), 1 - 1e-6);
+    return -400 * log10(1 / s - 1);
+}
+
+// Результаты матча для настройки A
+struct MatchStats
+{
+    int wins = 0, draws = 0, losses = 0;
+
+    int games() const
+    {
+        return wins + draws + losses;
+    }
+
+    double score() const
+    {
+        return (wins + 0.5 * draws) / max(games(), 1);
+    }
+
+    // Дисперсия очков за партию
+    double variance() const
+    {
+        const double s = score();
+        return (wins * (1 - s) * (1 - s) + draws * (0.5 - s) * (0.5 - s) + losses * s * s) / max(games(), 1);
+    }
+
+    // Половина 95% доверительного интервала разницы в рейтинге
+    double elo_error() const
+    {
+        const double margin = 1.96 * sqrt(variance() / max(games(), 1));
+        return (score_to_elo(score() + margin) - score_to_elo(score() - margin)) / 2;
+    }
+
+    // Логарифм отношения правдоподобия гипотез elo1 и elo0
+    // (нормальное приближение для результатов с ничьими)
+    double llr(const double elo0, const double elo1) const
+    {
+        const double var = variance();
+        if (!games() || var <= 0)
+            return 0;
+        const double s0 = elo_to_score(elo0), s1 = elo_to_score(elo1);
+        return games() * (s1 - s0) * (2 * score() - s0 - s1) / (2 * var);
+    }
+};
+
+// Заполняет настройки engine: settings.json, изменения для матча и настройки из json_text
+void setup_engine(Engine &engine, const string &json_text)
+{
+    Config &config = engine.config;
+    // Поиск без ограничения по времени в одном потоке (параллельно играются партии),
+    // без дебютной книги (начало партии случайное) и с повторяемым выбором хода
+    config.set("Bot", "BotTimeLimitMS", 0);
+    config.set("Bot", "Threads", 1);
+    config.set("Bot", "OpeningBook", "");
+    config.set("Bot", "NoRandom", true);
+    config.set("Bot", "TTSizeMB", 16);
+    const json overrides = json::parse(json_text);
+    for (const auto &item : overrides.items())
+    {
+        if (item.key() == "Level")
+            engine.level = item.value();
+        else
+            config.set("Bot", item.key(), item.value());
+    }
+}
+
+// Делает ход series игрока color в позиции pos
+void apply_series(Logic &logic, const bool color, Position &pos, const vector<move_pos> &series)
+{
+    for (const auto &turn : logic.find_series(color, pos))
+    {
+        if (turn.series == series)
+        {
+            pos = turn.final_pos;
+            return;
+        }
+    }
+    throw runtime_error("illegal move from search");
+}
+
+// Играет партию номер game. Возвращает 1, если выиграла настройка A,
+// -1, если B, и 0 при ничьей.
+int play_game(Engine &a, Engine &b, const int game, const int random_plies, const int max_plies)
+{
+    Logic logic_a(&a.config), logic_b(&b.config);
+    logic_a.Max_depth = a.level;
+    logic_b.Max_depth = b.level;
+    // Четные партии A играет белыми, нечетные - черными с тем же началом
+    const bool a_color = game % 2 != 0;
+    mt19937 rnd(game / 2);
+
+    bool color;
+    Position pos = Position::from_fen(
+        "W:Wa1,c1,e1,g1,b2,d2,f2,h2,a3,c3,e3,g3:Bb6,d6,f6,h6,a7,c7,e7,g7,b8,d8,f8,h8", color);
+    for (int ply = 0; ply < max_plies; ++ply)
+    {
+        Logic &logic = color == a_color ? logic_a : logic_b;
+        Engine &engine = color == a_color ? a : b;
+        const vector<Turn> turns = logic.find_series(color, pos);
+        // Нет ходов - поражение
+        if (turns.empty())
+            return color == a_color ? -1 : 1;
+        if (ply < random_plies)
+        {
+            pos = turns[rnd() % turns.size()].final_pos;
+        }
+        else
+        {
+            const uint64_t nodes_before = logic.nodes;
+            const auto start = chrono::steady_clock::now();
+            const vector<move_pos> series = logic.find_best_turns(color, pos);
+            engine.search_us +=
+                chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+            engine.nodes += logic.nodes - nodes_before;
+            apply_series(logic, color, pos, series);
+        }
+        color = !color;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const int games = argc > 1 ? stoi(argv[1]) : 1000;
+    const int threads = argc > 2 ? stoi(argv[2]) : max(1, int(thread::hardware_concurrency()));
+    const string json_a = argc > 3 ? string(argv[3]) : "{}";
+    const string json_b = argc > 4 ? string(argv[4]) : "{}";
+    const int random_plies = argc > 5 ? stoi(argv[5]) : 4;
+    const double elo0 = argc > 6 ? stod(argv[6]) : 0;
+    const double elo1 = argc > 7 ? stod(argv[7]) : 10;
+
+    Engine a, b;
+    setup_engine(a, json_a);
+    setup_engine(b, json_b);
+    const int max_plies = a.config("Game", "MaxNumTurns");
+    // Границы SPRT для логарифма отношения правдоподобия
+    const double llr_lower = log(SPRT_BETA / (1 - SPRT_ALPHA)), llr_upper = log((1 - SPRT_BETA) / SPRT_ALPHA);
+
+    cout << "A: " << json_a << "\nB: " << json_b << "\n"
+         << games << " games, " << threads << " threads, " << random_plies << " random plies, SPRT elo0 " << elo0
+         << ", elo1 " << elo1 << "\n";
+
+    MatchStats stats;
+    mutex stats_mutex;
+    atomic<int> next_game(0);
+    atomic<bool> stop(false);
+    string sprt_result;
+    const int report_every = max(1, games / 20);
+    const auto start = chrono::steady_clock::now();
+
+    auto report = [&]() {
+        ostringstream line;
+        line << fixed << setprecision(1) << "games " << stats.games() << ": +" << stats.wins << " =" << stats.draws
+             << " -" << stats.losses << ", score " << setprecision(3) << stats.score() << ", Elo "
+             << setprecision(1) << score_to_elo(stats.score()) << " +- " << stats.elo_error() << ", LLR "
+             << setprecision(2) << stats.llr(elo0, elo1) << " (" << llr_lower << ", " << llr_upper << ")";
+        cout << line.str() << endl;
+    };
+
+    auto worker = [&]() {
+        for (int game = next_game++; game < games && !stop; game = next_game++)
+        {
+            const int result = play_game(a, b, game, random_plies, max_plies);
+            lock_guard<mutex> lock(stats_mutex);
+            if (result > 0)
+                ++stats.wins;
+            else if (result < 0)
+                ++stats.losses;
+            else
+                ++stats.draws;
+            const double llr = stats.llr(elo0, elo1);
+            if (sprt_result.empty() && (llr <= llr_lower || llr >= llr_upper))
+            {
+                // Партии, которые уже идут, доигрываются и тоже учитываются
+                sprt_result = llr >= llr_upper ? "H1 accepted: A is stronger by at least elo1"
+                                               : "H0 accepted: A is not stronger by elo1";
+                stop = true;
+            }
+            if (stats.games() % report_every == 0)
+                report();
+        }
+    };
+    vector<thread> pool;
+    for (int i = 0; i < threads; ++i)
+        pool.emplace_back(worker);
+    for (auto &th : pool)
+        th.join();
+
+    report();
+    cout << "SPRT: " << (sprt_result.empty() ? "inconclusive" : sprt_result) << "\n";
+    for (const Engine *engine : {&a, &b})
+    {
+        const double seconds = engine->search_us / 1e6;
+        cout << (engine == &a ? "A" : "B") << ": " << engine->nodes << " nodes, " << fixed << setprecision(1)
+             << seconds << " s of search, " << (uint64_t)(engine->nodes / max(seconds, 1e-6)) << " nodes/sec\n";
+    }
+    cout << "total " << (int)chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s\n";
+    return 0;
+}
@@ -0,0 +1,124 @@
+// Проверка архива партий в формате PDN.
+// Файл читается по одной партии (он отображается в память и не загружается
+// целиком, поэтому может быть больше памяти), а ходы каждой партии
+// проверяются генератором ходов бота. Партии проверяются параллельно
+// пачками по BATCH_SIZE: основной поток выделяет партии из файла,
+// у каждого потока проверки свой генератор.
+// Выводятся количество партий и ходов, скорость чтения и ошибки
+// (с номером байта начала партии в файле).
+//
+// Запуск из корня проекта (настройки читаются из settings.json):
+//     pdn [файл] [количество потоков] [сколько ошибок выводить]
+// По умолчанию файл из настройки PdnFile, все ядра, 10 ошибок.
+// Код выхода 1, если в архиве есть ошибки.
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Game/Config.h"
+#include "../Game/Logic.h"
+#include "../Game/Pdn.h"
+
+// Партий в пачке, которая проверяется параллельно
+const size_t BATCH_SIZE = 4096;
+
+int main(int argc, char *argv[])
+{
+    Config config;
+    // Нужен только генератор ходов
+    config.set("Bot", "TTSizeMB", 0);
+    config.set("Bot", "TablebasePath", "");
+    config.set("Bot", "OpeningBook", "");
+
+    const string path = argc > 1 ? string(argv[1]) : project_path + string(config("Game", "PdnFile"));
+    const int threads = argc > 2 ? stoi(argv[2]) : max(1, int(thread::hardware_concurrency()));
+    const size_t max_errors = argc > 3 ? stoul(argv[3]) : 10;
+    if (threads < 1)
+    {
+        cerr << "usage: pdn [file] [threads] [errors to print]\n";
+        return 1;
+    }
+
+    PdnReader reader;
+    if (!reader.open(path))
+    {
+        cerr << "can't open " << path << "\n";
+        return 1;
+    }
+
+    const auto start = chrono::steady_clock::now();
+    uint64_t games = 0, errors = 0;
+    atomic<uint64_t> turns(0);
+    mutex errors_mutex;
+    vector<string> error_texts;
+    auto add_error = [&](const string &text) {
+        lock_guard<mutex> lock(errors_mutex);
+        ++errors;
+        if (error_texts.size() < max_errors)
+            error_texts.push_back(text);
+    };
+
+    vector<Logic> logics;
+    logics.reserve(threads);
+    for (int i = 0; i < threads; ++i)
+        logics.emplace_back(&config);
+    vector<PdnRecord> batch(BATCH_SIZE);
+    while (true)
+    {
+        // Выделить партии пачки из файла
+        size_t count = 0;
+        while (count < BATCH_SIZE)
+        {
+            try
+            {
+                if (!reader.next(batch[count]))
+                    break;
+                ++count;
+            }
+            catch (const exception &e)
+            {
+                add_error(e.what());
+            }
+        }
+        if (count == 0)
+            break;
+        games += count;
+
+        // Проверить ходы партий пачки
+        atomic<size_t> next_game(0);
+        vector<thread> pool;
+        for (int i = 0; i < threads; ++i)
+        {
+            pool.emplace_back([&, i]() {
+                for (size_t g = next_game++; g < count; g = next_game++)
+                {
+                    try
+                    {
+                        turns += replay_pdn(batch[g], logics[i]).turns.size();
+                    }
+                    catch (const exception &e)
+                    {
+                        add_error(e.what());
+                    }
+                }
+            });
+        }
+        for (auto &th : pool)
+            th.join();
+    }
+
+    const double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    for (const auto &text : error_texts)
+        cout << text << "\n";
+    cout << path << ": " << games << " games, " << turns << " moves, " << errors << " errors\n"
+         << reader.size() / 1000000.0 << " MB in " << (int)ms << " ms, "
+         << reader.size() / 1000.0 / max(ms, 1.0) << " MB/sec, " << (uint64_t)(games / max(ms, 1.0) * 1000)
+         << " games/sec\n";
+    return errors ? 1 : 0;
+}
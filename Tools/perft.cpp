@@ -0,0 +1,279 @@
+// Perft: подсчет всех партий заданной длины из набора позиций.
+// Число листьев дерева ходов на глубине N - точная характеристика генератора
+// ходов: оно не зависит от поиска и оценки, поэтому любая ошибка в правилах
+// (обязательное взятие, взятие назад, серии взятий дамкой, превращение
+// во время взятия) меняет результат. Для набора позиций известны правильные
+// значения, и perft сравнивает с ними то, что получилось.
+//
+// Ходы, которые отличаются только порядком взятий и приводят к одной
+// позиции, считаются одним ходом (так же, как в generate_turns).
+//
+// Запуск из корня проекта (настройки читаются из settings.json):
+//     perft [глубина] [количество потоков] [размер хэша в МБ] [генератор]
+// По умолчанию глубина 7, все ядра, без хэша, генератор "turns" -
+// Logic::generate_turns, который использует поиск бота. Генератор "series" -
+// Logic::find_series, который использует интерфейс игры.
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Game/Config.h"
+#include "../Game/Logic.h"
+
+// Позиция набора и правильное число листьев на глубине 1, 2, ...
+struct PerftPosition
+{
+    string fen;
+    vector<uint64_t> nodes;
+};
+
+// Набор позиций: начальная, дебюты, миттельшпиль и эндшпили с дамками
+// (серии взятий дамкой, превращение во время взятия)
+const vector<PerftPosition> perft_positions = {
+    {"W:Wa1,c1,e1,g1,b2,d2,f2,h2,a3,c3,e3,g3:Bb6,d6,f6,h6,a7,c7,e7,g7,b8,d8,f8,h8", {7, 49, 302, 1469, 7482, 37986, 190146, 929978}},
+    {"B:Wa1,c1,g1,b2,d2,h2,a3,c3,e3,g3,f4:Ba5,e5,b6,d6,h6,a7,e7,g7,b8,d8,h8", {9, 42, 150, 664, 2534, 12003, 52850, 260342}},
+    {"W:Wa1,c1,e1,g1,b2,f2,h2,a3,c3,b4:Be3,g5,b6,d6,h6,a7,g7,b8,d8,f8,h8", {1, 11, 74, 515, 2771, 16615, 84405, 470901}},
+    {"W:Wc1,e1,g1,b2,d2,f2,h2,c3,e3,g3,b4:Ba5,e5,d6,f6,h6,a7,c7,e7,b8,f8,h8", {7, 38, 192, 891, 4289, 19490, 91852, 417764}},
+    {"B:Wa1,b2,a3,b4,g7,Kf8:Bd6,a7,b8,d8,h8", {1, 1, 6, 42, 188, 1259, 5731, 36506}},
+    {"W:Wa1,e1,b2,h2,e3,h4,d6,Kc7:Bb6,g7,h8", {1, 2, 32, 75, 512, 1112, 6775, 16996}},
+    {"W:WKa1,Kh2,c3:BKb8,Kh6,e7", {9, 81, 522, 5030, 37948, 351919, 2862720, 26058373}},
+    {"W:WKa1,Kc1,Ke1,Kg1:BKb8,Kd8,Kf8,Kh8", {27, 382, 4906, 60231, 726502, 8688255, 102852564, 1224443757}},
+    {"W:WKh2:Bb2,d2,f2,b4,d4,f4,b6,d6,f6", {53, 232, 1706, 10634, 67964, 504178, 3250261, 26315101}},
+    {"W:Wc3,e3:Bb4,d6,f6,d4,f4", {7, 18, 49, 205, 464, 1664, 5528, 28556}},
+};
+
+// Кэш результатов perft: ключ - хэш позиции с очередностью хода и глубиной.
+// Работает без блокировок так же, как TTable: ключ хранится в виде xor
+// с числом листьев, поэтому частично переписанная запись не найдется.
+class PerftCache
+{
+  public:
+    explicit PerftCache(const size_t size_mb)
+    {
+        const size_t max_entries = size_mb * 1024 * 1024 / sizeof(Slot);
+        size_t entries = 1;
+        while (entries * 2 <= max_entries)
+            entries *= 2;
+        if (max_entries)
+        {
+            table.reset(new Slot[entries]);
+            mask = entries - 1;
+        }
+    }
+
+    bool enabled() const
+    {
+        return table != nullptr;
+    }
+
+    bool probe(const uint64_t key, uint64_t &nodes) const
+    {
+        const Slot &slot = table[key & mask];
+        const uint64_t value = slot.nodes.load(memory_order_relaxed);
+        if ((slot.key.load(memory_order_relaxed) ^ value) != key)
+            return false;
+        nodes = value;
+        return true;
+    }
+
+    void store(const uint64_t key, const uint64_t nodes)
+    {
+        Slot &slot = table[key & mask];
+        slot.key.store(key ^ nodes, memory_order_relaxed);
+        slot.nodes.store(nodes, memory_order_relaxed);
+    }
+
+  private:
+    struct Slot
+    {
+        atomic<uint64_t> key{0};
+        atomic<uint64_t> nodes{0};
+    };
+
+    unique_ptr<Slot[]> table;
+    size_t mask = 0;
+};
+
+// Ключ кэша для позиции с хэшем hash, ходом игрока color и глубиной depth
+uint64_t cache_key(const uint64_t hash, const bool color, const int depth)
+{
+    return (hash ^ (color ? zobrist().black_move : 0)) * 0x9E3779B97F4A7C15ull + uint64_t(depth);
+}
+
+// Подсчет листьев одним потоком
+class Perft
+{
+  public:
+    Perft(Config *config, PerftCache &cache, const bool use_series) : logic(config), cache(cache), use_series(use_series)
+    {
+    }
+
+    // Все ходы игрока color в позиции pos (позиции после хода)
+    void expand(const bool color, const Position &pos, vector<Position> &res)
+    {
+        res.clear();
+        if (use_series)
+        {
+            for (const auto &turn : logic.find_series(color, pos))
+            {
+                if (find(res.begin(), res.end(), turn.final_pos) == res.end())
+                    res.push_back(turn.final_pos);
+            }
+            return;
+        }
+        TurnList &list = lists[0];
+        logic.generate_turns(color, pos, list);
+        for (int i = 0; i < list.size; ++i)
+        {
+            Position next = pos;
+            list.turns[i].apply(next, color);
+            res.push_back(next);
+        }
+    }
+
+    // Число листьев на глубине depth из позиции pos с ходом игрока color
+    uint64_t count(const bool color, const Position &pos, const int depth)
+    {
+        if (depth == 0)
+            return 1;
+        uint64_t key = 0, nodes = 0;
+        if (cache.enabled() && depth > 1)
+        {
+            key = cache_key(hash_position(pos), color, depth);
+            if (cache.probe(key, nodes))
+                return nodes;
+        }
+        if (use_series)
+        {
+            vector<Position> next;
+            expand(color, pos, next);
+            if (depth == 1)
+                return next.size();
+            for (const auto &p : next)
+                nodes += count(!color, p, depth - 1);
+        }
+        else
+        {
+            // Списки ходов для каждой глубины, чтобы не выделять память
+            TurnList &list = lists[depth];
+            logic.generate_turns(color, pos, list);
+            if (depth == 1)
+                return uint64_t(list.size);
+            for (int i = 0; i < list.size; ++i)
+            {
+                Position next = pos;
+                list.turns[i].apply(next, color);
+                nodes += count(!color, next, depth - 1);
+            }
+        }
+        if (cache.enabled() && depth > 1)
+            cache.store(key, nodes);
+        return nodes;
+    }
+
+  private:
+    Logic logic;
+    PerftCache &cache;
+    bool use_series;
+    vector<TurnList> lists = vector<TurnList>(MAX_PLY);
+};
+
+// Корневое разбиение: позиции, с которых потоки начинают подсчет.
+// Дерево раскрывается, пока задач не станет хотя бы по 8 на поток.
+struct PerftTask
+{
+    Position pos;
+    bool color;
+    int depth;
+};
+
+vector<PerftTask> split(Perft &perft, const PerftTask &root, const int threads)
+{
+    vector<PerftTask> tasks = {root};
+    vector<Position> next;
+    while (tasks.size() < size_t(threads) * 8 && tasks.front().depth > 2)
+    {
+        vector<PerftTask> expanded;
+        for (const auto &task : tasks)
+        {
+            perft.expand(task.color, task.pos, next);
+            for (const auto &p : next)
+                expanded.push_back({p, !task.color, task.depth - 1});
+        }
+        if (expanded.empty())
+            break;
+        tasks = move(expanded);
+    }
+    return tasks;
+}
+
+int main(int argc, char *argv[])
+{
+    const int depth = argc > 1 ? stoi(argv[1]) : 7;
+    const int threads = argc > 2 ? stoi(argv[2]) : max(1, int(thread::hardware_concurrency()));
+    const size_t hash_mb = argc > 3 ? stoul(argv[3]) : 0;
+    const string generator = argc > 4 ? string(argv[4]) : "turns";
+    if (depth < 1 || depth > MAX_DEPTH || (generator != "turns" && generator != "series"))
+    {
+        cerr << "usage: perft [depth] [threads] [hash MB] [turns|series]\n";
+        return 1;
+    }
+
+    Config config;
+    // Нужен только генератор ходов
+    config.set("Bot", "TTSizeMB", 0);
+    config.set("Bot", "TablebasePath", "");
+    config.set("Bot", "OpeningBook", "");
+
+    cout << "depth " << depth << ", threads " << threads << ", hash " << hash_mb << " MB, generator " << generator
+         << "\n";
+    PerftCache cache(hash_mb);
+    uint64_t total_nodes = 0;
+    double total_ms = 0;
+    bool all_ok = true;
+    for (const auto &position : perft_positions)
+    {
+        bool color;
+        const Position pos = Position::from_fen(position.fen, color);
+        const auto start = chrono::steady_clock::now();
+
+        Perft root_perft(&config, cache, generator == "series");
+        const vector<PerftTask> tasks = split(root_perft, {pos, color, depth}, threads);
+        atomic<size_t> next_task(0);
+        atomic<uint64_t> nodes(0);
+        vector<thread> pool;
+        for (int i = 0; i < threads; ++i)
+        {
+            pool.emplace_back([&]() {
+                Perft perft(&config, cache, generator == "series");
+                for (size_t t = next_task++; t < tasks.size(); t = next_task++)
+                    nodes += perft.count(tasks[t].color, tasks[t].pos, tasks[t].depth);
+            });
+        }
+        for (auto &th : pool)
+            th.join();
+
+        const double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cout << position.fen << "\n    nodes " << nodes << ", " << (int)ms << " ms, "
+             << (uint64_t)(nodes / max(ms, 1.0) * 1000) << " nodes/sec";
+        if (size_t(depth) <= position.nodes.size())
+        {
+            const bool ok = nodes == position.nodes[depth - 1];
+            all_ok = all_ok && ok;
+            cout << (ok ? ", ok" : ", MISMATCH: expected " + to_string(position.nodes[depth - 1]));
+        }
+        cout << "\n";
+        total_nodes += nodes;
+        total_ms += ms;
+    }
+    cout << "total nodes " << total_nodes << ", " << (int)total_ms << " ms, "
+         << (uint64_t)(total_nodes / max(total_ms, 1.0) * 1000) << " nodes/sec\n";
+    return all_ok ? 0 : 1;
+}
@@ -0,0 +1,212 @@
+// Построение эндшпильных таблиц ретроградным анализом.
+// Таблицы строятся для всех материалов с числом фигур не больше заданного,
+// начиная с самых маленьких: взятие или превращение переводит позицию
+// в уже построенную таблицу. Внутри таблицы значения находятся проходами
+// по всем позициям: на проходе p определяются позиции, которые заканчиваются
+// ровно через p ходов. Позиции, которые так и не определились, - ничьи.
+// Проходы выполняются параллельно на всех ядрах.
+//
+// Запуск из корня проекта (настройки читаются из settings.json):
+//     tbgen [число фигур] [количество потоков] [каталог]
+// По умолчанию строятся таблицы до 4 фигур в каталог из настройки TablebasePath.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../Game/Config.h"
+#include "../Game/Logic.h"
+#include "../Game/Tablebase.h"
+
+// Значения уже построенных таблиц
+unordered_map<uint32_t, vector<uint8_t>> finished;
+
+// Строит таблицы материалов group (материал и его зеркальный, которые
+// ссылаются друг на друга простыми ходами) и возвращает их значения
+vector<vector<uint8_t>> solve(const Logic &logic, const vector<Material> &group, const int threads)
+{
+    vector<vector<uint8_t>> values(group.size());
+    // Состояние позиции: 0 - не определена, 1 - определена, 2 - номер без позиции
+    vector<vector<uint8_t>> state(group.size());
+    for (size_t g = 0; g < group.size(); ++g)
+    {
+        values[g].assign(group[g].size(), 0);
+        state[g].assign(group[g].size(), 0);
+    }
+
+    // Значение позиции с ходом белых из таблицы группы (на прошлом проходе) или из готовой
+    auto lookup = [&](const vector<vector<uint8_t>> &old_values, const Position &pos) -> int {
+        const Material material = Material::of(pos);
+        for (size_t g = 0; g < group.size(); ++g)
+        {
+            if (group[g] == material)
+                return old_values[g][material.index(pos)];
+        }
+        return finished.at(material.key())[material.index(pos)];
+    };
+
+    const uint64_t chunk = 4096;
+    for (int pass = 0;; ++pass)
+    {
+        const vector<vector<uint8_t>> old_values = values;
+        atomic<bool> changed(false), pending(false), too_long(false);
+        atomic<uint64_t> next_chunk(0);
+        vector<uint64_t> chunks;
+        for (const auto &material : group)
+            chunks.push_back((material.size() + chunk - 1) / chunk);
+
+        auto worker = [&]() {
+            TurnList list;
+            for (uint64_t c = next_chunk++;; c = next_chunk++)
+            {
+                // Найти таблицу и диапазон номеров для порции c
+                size_t g = 0;
+                while (g < group.size() && c >= chunks[g])
+                    c -= chunks[g++];
+                if (g == group.size())
+                    return;
+                const Material &material = group[g];
+                const uint64_t end = min(material.size(), (c + 1) * chunk);
+                for (uint64_t idx = c * chunk; idx < end; ++idx)
+                {
+                    if (state[g][idx])
+                        continue;
+                    Position pos;
+                    if (!material.position(idx, pos))
+                    {
+                        state[g][idx] = 2;
+                        continue;
+                    }
+
+                    // Ходы белых. Нет ходов - проигрыш на месте.
+                    logic.generate_turns(false, pos, list);
+                    int win = TB_MAX_DISTANCE + 1, loss = 0;
+                    bool all_known = true;
+                    for (int i = 0; i < list.size; ++i)
+                    {
+                        Position next = pos;
+                        list.turns[i].apply(next, false);
+                        // Значение для черных, которые ходят следующими
+                        const int value = next.black ? lookup(old_values, next.flipped()) : 1;
+                        if (tb_is_loss(value))
+                            win = min(win, value);
+                        else if (tb_is_win(value))
+                            loss = max(loss, value);
+                        else
+                            all_known = false;
+                    }
+
+                    // Выигрыш - если есть ход в проигрыш соперника, проигрыш - если все ходы
+                    // ведут к выигрышу соперника. Расстояние принимается, только когда проход
+                    // до него дошел: тогда оно кратчайшее для выигрыша и длиннейшее для проигрыша.
+                    int distance = -1;
+                    if (win <= TB_MAX_DISTANCE)
+                        distance = win;
+                    else if (all_known)
+                        distance = loss;
+                    if (distance < 0)
+                        continue;
+                    if (distance > pass)
+                    {
+                        pending = true;
+                        continue;
+                    }
+                    if (distance > TB_MAX_DISTANCE - 1)
+                    {
+                        too_long = true;
+                        continue;
+                    }
+                    values[g][idx] = uint8_t(distance + 1);
+                    state[g][idx] = 1;
+                    changed = true;
+                }
+            }
+        };
+        vector<thread> pool;
+        for (int i = 0; i < threads; ++i)
+            pool.emplace_back(worker);
+        for (auto &th : pool)
+            th.join();
+        if (too_long)
+            throw runtime_error("tablebase distance is too long: " + group.front().file_name());
+        if (!changed && !pending)
+            break;
+    }
+    return values;
+}
+
+int main(int argc, char *argv[])
+{
+    const int max_pieces = argc > 1 ? stoi(argv[1]) : 4;
+    const int threads = argc > 2 ? stoi(argv[2]) : max(1, int(thread::hardware_concurrency()));
+    Config config;
+    const string dir = argc > 3 ? string(argv[3]) : project_path + string(config("Bot", "TablebasePath"));
+    if (max_pieces < 2 || max_pieces > TB_MAX_PIECES)
+    {
+        cerr << "number of pieces must be from 2 to " << TB_MAX_PIECES << "\n";
+        return 1;
+    }
+    filesystem::create_directories(dir);
+    const Logic logic(&config);
+
+    // Все материалы, у каждой стороны есть хотя бы одна фигура.
+    // Сначала меньше фигур (взятия), при равном числе - меньше пешек (превращения).
+    vector<Material> materials;
+    for (int wm = 0; wm <= max_pieces; ++wm)
+        for (int wk = 0; wm + wk <= max_pieces; ++wk)
+            for (int bm = 0; wm + wk + bm <= max_pieces; ++bm)
+                for (int bk = 0; wm + wk + bm + bk <= max_pieces; ++bk)
+                {
+                    if (wm + wk && bm + bk)
+                        materials.push_back({wm, wk, bm, bk});
+                }
+    stable_sort(materials.begin(), materials.end(), [](const Material &a, const Material &b) {
+        return make_pair(a.pieces(), a.men()) < make_pair(b.pieces(), b.men());
+    });
+
+    cout << "tablebases up to " << max_pieces << " pieces, " << threads << " threads, " << dir << "\n";
+    const auto total_start = chrono::steady_clock::now();
+    for (const auto &material : materials)
+    {
+        if (finished.count(material.key()))
+            continue;
+        vector<Material> group = {material};
+        if (!(material.swapped() == material))
+            group.push_back(material.swapped());
+
+        const auto start = chrono::steady_clock::now();
+        const auto values = solve(logic, group, threads);
+        const double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        for (size_t g = 0; g < group.size(); ++g)
+        {
+            const auto data = Tablebase::encode(group[g], values[g]);
+            ofstream fout(dir + "/" + group[g].file_name(), ios::binary);
+            fout.write(reinterpret_cast<const char *>(data.data()), streamsize(data.size()));
+            if (!fout)
+            {
+                cerr << "cannot write " << dir + "/" + group[g].file_name() << "\n";
+                return 1;
+            }
+
+            uint64_t wins = 0, losses = 0, longest = 0;
+            for (const uint8_t value : values[g])
+            {
+                wins += tb_is_win(value);
+                losses += tb_is_loss(value);
+                longest = max<uint64_t>(longest, value ? value - 1 : 0);
+            }
+            cout << group[g].file_name() << ": " << values[g].size() << " indices, " << wins << " wins, " << losses
+                 << " losses, longest " << longest << " moves, " << data.size() << " bytes, " << (int)ms
+                 << " ms\n";
+            finished[group[g].key()] = values[g];
+        }
+    }
+    cout << "total " << (int)chrono::duration<double>(chrono::steady_clock::now() - total_start).count() << " s\n";
+    return 0;
+}